@@ -41,6 +41,31 @@
 #include <limits.h>
 #include <assert.h>
 #include <errno.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#define HAVE_MMAP       1
+#define HAVE_THREADS    1
+#else
+#define HAVE_MMAP       0
+#define HAVE_THREADS    0
+#endif
+#if HAVE_THREADS && defined(__GNUC__)
+#define HAVE_ATOMICS    1
+#else
+#define HAVE_ATOMICS    0
+#endif
+#include <stdint.h>
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_SSE2       1
+#else
+#define HAVE_SSE2       0
+#endif
 
 #include "dbginfo.h"
 
@@ -59,6 +84,47 @@
 #define VER_MAJOR       2U
 #define VER_MINOR       0U
 
+/* Large input in memory is parsed in chunks by several threads. Each
+** thread gets at least PARSE_CHUNK_SIZE bytes. PARSE_THREADS is the maximum
+** number of threads, zero means one per online CPU.
+*/
+#ifndef PARSE_THREADS
+#define PARSE_THREADS           0
+#endif
+#ifndef PARSE_CHUNK_SIZE
+#define PARSE_CHUNK_SIZE        (4UL << 20)
+#endif
+#define MAX_PARSE_THREADS       64
+
+/* The sorts done after parsing run on several threads if they have at least
+** PARALLEL_SORT_ITEMS items in total. Collections with at least
+** SPLIT_SORT_ITEMS items are split over the threads and merged afterwards.
+*/
+#ifndef PARALLEL_SORT_ITEMS
+#define PARALLEL_SORT_ITEMS     (1U << 15)
+#endif
+#ifndef SPLIT_SORT_ITEMS
+#define SPLIT_SORT_ITEMS        (1U << 16)
+#endif
+
+/* Default for the memory that may be used for the table that maps addresses
+** directly to spans, see cc65_dbgoptions.
+*/
+#ifndef ADDRMAP_BUDGET
+#define ADDRMAP_BUDGET          (16UL << 20)
+#endif
+
+/* Batch lookups by address use an address map with up to this many entries
+** for each address, because it fits into the cache. With a larger map, or
+** without a map, it's faster to sort many addresses and sweep over the spans.
+*/
+#ifndef ADDRMAP_CACHED
+#define ADDRMAP_CACHED          (1UL << 18)
+#endif
+
+/* Name used for debug info parsed from memory */
+#define MEM_INPUT_NAME          "<memory>"
+
 /* Dynamic strings */
 typedef struct StrBuf StrBuf;
 struct StrBuf {
@@ -70,6 +136,59 @@ struct StrBuf {
 /* Initializer for a string buffer */
 #define STRBUF_INITIALIZER      { 0, 0, 0 }
 
+/* A string that is not owned and not terminated, for example a token in the
+** input buffer.
+*/
+typedef struct StrRef StrRef;
+struct StrRef {
+    const char* Ptr;                    /* Pointer to first character */
+    unsigned    Len;                    /* Length of the string */
+};
+
+/* Initializer for a string reference */
+#define STRREF_INITIALIZER      { "", 0 }
+
+/* A string in a string pool. The names of items point to Str, so the pool
+** entry of a name can be found from the name.
+*/
+typedef struct PoolStr PoolStr;
+struct PoolStr {
+    unsigned            Id;             /* Id, alphabetical once ranked */
+    unsigned            Hash;           /* Hash value of the string */
+    unsigned            Len;            /* Length of the string */
+    char                Str[1];         /* The string itself */
+};
+
+/* A set of unique strings. Equal strings in a pool have the same address,
+** and ids of ranked pools sort like the strings.
+*/
+typedef struct StrPool StrPool;
+struct StrPool {
+    unsigned            Count;          /* Number of strings */
+    unsigned            Size;           /* Size of hash table, power of two */
+    PoolStr**           Tab;            /* Hash table */
+};
+
+/* Memory arena. Memory is taken from large blocks by advancing a pointer and
+** is freed only as a whole. All items of a debug info are allocated this way.
+*/
+typedef struct ArenaBlock ArenaBlock;
+struct ArenaBlock {
+    ArenaBlock*         Next;           /* Next block in list */
+};
+
+typedef struct Arena Arena;
+struct Arena {
+    ArenaBlock*         Blocks;         /* List of blocks, current one first */
+    char*               Pos;            /* Next free byte in current block */
+    char*               End;            /* End of current block */
+    Arena*              Next;           /* Arenas merged into this one */
+};
+
+/* Size of arena blocks and alignment of allocations */
+#define ARENA_BLOCK_SIZE        (64UL << 10)
+#define ARENA_ALIGN             8U
+
 /* An array of unsigneds/pointers that grows if needed. C guarantees that a
 ** pointer to a union correctly converted points to each of its members.
 ** So what we do here is using union entries that contain an unsigned
@@ -87,19 +206,50 @@ struct Collection {
     unsigned            Count;          /* Number of items in the list */
     unsigned            Size;           /* Size of allocated array */
     CollEntry*          Items;          /* Array with dynamic size */
+    Arena*              A;              /* Arena for Items or NULL */
 };
 
 /* Initializer for static collections */
-#define COLLECTION_INITIALIZER  { 0, 0, 0 }
+#define COLLECTION_INITIALIZER  { 0, 0, 0, 0 }
+
+/* Hash index for a collection sorted by name. For each name, it holds the
+** position of the group of items with this name. Names are looked up by the
+** id of the pooled name, see StrPool.
+*/
+typedef struct NameGroup NameGroup;
+struct NameGroup {
+    unsigned            Name;           /* Id of the pooled name */
+    unsigned            First;          /* Index of first item with this name */
+    unsigned            Count;          /* Number of items, zero if unused */
+};
+
+typedef struct NameIndex NameIndex;
+struct NameIndex {
+    unsigned            Size;           /* Size of hash table, power of two */
+    NameGroup*          Tab;            /* Hash table */
+};
+
+/* A numeric sort key for an item in a collection, see CollSortByKey */
+typedef struct CollKey CollKey;
+struct CollKey {
+    unsigned            Hi;             /* High part of the key */
+    unsigned            Lo;             /* Low part of the key */
+    void*               Ptr;            /* The item */
+};
 
-/* Span info management. The following table has as many entries as there
-** are addresses active in spans. Each entry lists the spans for this address.
+/* Span info management. The following table has one entry per span, sorted
+** by address. The entries form an implicit balanced binary tree: The root of
+** a range of entries is the one in the middle, and the halves left and right
+** of it are its subtrees. Each entry holds the highest end address found in
+** its subtree, so a search for an address can skip subtrees that end before
+** it.
 */
 typedef struct SpanInfoListEntry SpanInfoListEntry;
 struct SpanInfoListEntry {
-    cc65_addr           Addr;           /* Unique address */
-    unsigned            Count;          /* Number of SpanInfos for this address */
-    void*               Data;           /* Either SpanInfo* or SpanInfo** */
+    cc65_addr           Start;          /* Start of span */
+    cc65_addr           End;            /* End of span */
+    cc65_addr           MaxEnd;         /* Highest end address in subtree */
+    struct SpanInfo*    Span;           /* The span itself */
 };
 
 typedef struct SpanInfoList SpanInfoList;
@@ -108,6 +258,23 @@ struct SpanInfoList {
     SpanInfoListEntry*  List;           /* Dynamic array with entries */
 };
 
+/* Table that maps each address in a range directly to the spans covering
+** it. Neighbouring addresses covered by the same spans share one group of
+** spans. The table is created with the span index if it fits into the
+** budget.
+*/
+typedef struct AddrMap AddrMap;
+struct AddrMap {
+    unsigned long       Budget;         /* Memory the table may use */
+    cc65_addr           Base;           /* First address in the table */
+    unsigned long       Size;           /* Number of addresses */
+    unsigned*           Slots;          /* Group index per address, or NULL */
+    unsigned*           Groups;         /* Group I is Spans[Groups[I]] up to
+                                        ** Spans[Groups[I+1]]; group 0 is empty
+                                        */
+    const struct SpanInfo** Spans;      /* Spans of all groups */
+};
+
 /* Input tokens */
 typedef enum {
 
@@ -176,6 +343,17 @@ typedef enum {
     TOK_IDENT,                          /* To catch unknown keywords */
 } Token;
 
+/* Secondary indexes that are built on first use, see NeedIndex */
+typedef enum {
+    INDEX_LINES,                        /* Line infos of files by line */
+    INDEX_SCOPES,                       /* Scope infos by name */
+    INDEX_SPANS,                        /* Span info list and address map */
+    INDEX_SPANORDER,                    /* Span infos sorted by address */
+    INDEX_SYMBOLS,                      /* Symbol infos by name */
+    INDEX_SYMVALS,                      /* Symbol and label infos by value */
+    INDEX_COUNT                         /* Number of indexes */
+} IndexKind;
+
 /* Data structure containing information from the debug info file. A pointer
 ** to this structure is passed as handle to callers from the outside.
 */
@@ -204,11 +382,32 @@ struct DbgInfo {
     Collection          ModInfoByName;  /* Module info sorted by name */
     Collection          ScopeInfoByName;/* Scope infos sorted by name */
     Collection          SegInfoByName;  /* Segment infos sorted by name */
+    Collection          SegInfoByAddr;  /* Segment infos sorted by address */
     Collection          SymInfoByName;  /* Symbol infos sorted by name */
     Collection          SymInfoByVal;   /* Symbol infos sorted by value */
+    Collection          LabelInfoByVal; /* Labels from SymInfoByVal */
+
+    /* Hash indexes for the collections above */
+    NameIndex           CSymFuncIndex;  /* Index for CSymFuncByName */
+    NameIndex           ScopeIndex;     /* Index for ScopeInfoByName */
+    NameIndex           SegIndex;       /* Index for SegInfoByName */
+    NameIndex           SymIndex;       /* Index for SymInfoByName */
+
+    /* Secondary indexes aren't built before they're needed. Until then,
+    ** the collections that belong to them are unsorted.
+    */
+    Collection          Sorts[INDEX_COUNT]; /* Pending sorts per index */
+    unsigned            Built;          /* Bit set of indexes built */
+#if HAVE_THREADS
+    pthread_mutex_t     Lock;           /* Serializes building indexes */
+#endif
 
     /* Other stuff */
+    Collection          SpanInfoByStart;/* Span infos sorted by address */
     SpanInfoList        SpanInfoByAddr; /* Span infos sorted by unique address */
+    AddrMap             SpanMap;        /* Spans by address for fast lookup */
+    Arena*              Mem;            /* Memory for all items */
+    StrPool             Names;          /* Names of all items */
 
     /* Info data */
     unsigned long       MemUsage;       /* Memory usage for the data */
@@ -222,19 +421,48 @@ typedef struct InputData InputData;
 struct InputData {
     const char*         FileName;       /* Name of input file */
     cc65_line           Line;           /* Current line number */
-    unsigned            Col;            /* Current column number */
     cc65_line           SLine;          /* Line number at start of token */
     unsigned            SCol;           /* Column number at start of token */
     unsigned            Errors;         /* Number of errors */
-    FILE*               F;              /* Input file */
+    FILE*               F;              /* Input file if read through stdio */
+    StrBuf              LineBuf;        /* Current line for stdio input */
+    const char*         Buf;            /* Input buffer */
+    const char*         Pos;            /* Next character in Buf */
+    const char*         End;            /* End of Buf */
+    const char*         LineStart;      /* Start of current line in Buf */
+    size_t              MapSize;        /* Size of mapping, zero if none */
+    const char*         Block;          /* Classified 64 byte block of Buf */
+    uint64_t            DelimMask;      /* Non identifier chars in Block */
+    uint64_t            QuoteMask;      /* '"' and '\n' in Block */
     int                 C;              /* Input character */
     Token               Tok;            /* Token from input stream */
     unsigned long       IVal;           /* Integer constant */
-    StrBuf              SVal;           /* String constant */
+    StrRef              SVal;           /* Identifier or string constant */
     cc65_errorfunc      Error;          /* Function called in case of errors */
+    Collection*         Deferred;       /* Errors to report later or NULL */
+    Collection          Sorts;          /* Sorts to run after processing */
+    unsigned            Records;        /* Record kinds to load */
+    unsigned long       AddrMapBudget;  /* Memory for address table */
     DbgInfo*            Info;           /* Pointer to debug info */
 };
 
+/* A sort to run after processing, or a part of one. A job sorts the items
+** from Lo to Hi - 1 of a collection, either with Compare or, if that is
+** NULL, with KeySort. If Mid is not equal to Lo, the job doesn't sort but
+** merges the sorted items from Lo to Mid - 1 and from Mid to Hi - 1, using
+** Tmp as temporary storage.
+*/
+typedef struct SortJob SortJob;
+struct SortJob {
+    Collection*         C;              /* Collection to sort */
+    int                 (*Compare) (const void*, const void*);
+    void                (*KeySort) (Collection*);
+    unsigned            Lo;             /* First item */
+    unsigned            Mid;            /* Start of second half for merges */
+    unsigned            Hi;             /* Last item plus one */
+    CollEntry*          Tmp;            /* Temporary storage for merges */
+};
+
 /* Typedefs for the item structures. Do also serve as forwards */
 typedef struct CSymInfo CSymInfo;
 typedef struct FileInfo FileInfo;
@@ -265,7 +493,7 @@ struct CSymInfo {
         unsigned        Id;             /* Id of scope */
         ScopeInfo*      Info;           /* Pointer to scope */
     } Scope;
-    char                Name[1];        /* Name of file with full path */
+    const char*         Name;           /* Name of file with full path */
 };
 
 /* Internally used file info struct */
@@ -275,13 +503,13 @@ struct FileInfo {
     unsigned long       MTime;          /* Modification time */
     Collection          ModInfoByName;  /* Modules in which this file is used */
     Collection          LineInfoByLine; /* Line infos sorted by line */
-    char                Name[1];        /* Name of file with full path */
+    const char*         Name;           /* Name of file with full path */
 };
 
 /* Internally used library info struct */
 struct LibInfo {
     unsigned            Id;             /* Id of library */
-    char                Name[1];        /* Name of library with path */
+    const char*         Name;           /* Name of library with path */
 };
 
 /* Internally used line info struct */
@@ -312,7 +540,7 @@ struct ModInfo {
     Collection          CSymFuncByName; /* C functions by name */
     Collection          FileInfoByName; /* Files for this module */
     Collection          ScopeInfoByName;/* Scopes for this module */
-    char                Name[1];        /* Name of module with path */
+    const char*         Name;           /* Name of module with path */
 };
 
 /* Internally used scope info struct */
@@ -337,7 +565,7 @@ struct ScopeInfo {
     Collection          SymInfoByName;  /* Symbols in this scope */
     Collection*         CSymInfoByName; /* C symbols for this scope */
     Collection*         ChildScopeList; /* Child scopes of this scope */
-    char                Name[1];        /* Name of scope */
+    const char*         Name;           /* Name of scope */
 };
 
 /* Internally used segment info struct */
@@ -345,9 +573,12 @@ struct SegInfo {
     unsigned            Id;             /* Id of segment */
     cc65_addr           Start;          /* Start address of segment */
     cc65_size           Size;           /* Size of segment */
-    char*               OutputName;     /* Name of output file */
+    const char*         OutputName;     /* Name of output file */
     unsigned long       OutputOffs;     /* Offset in output file */
-    char                Name[1];        /* Name of segment */
+    const char*         Name;           /* Name of segment */
+    unsigned long       MaxEnd;         /* Highest end of the segments up to
+                                        ** this one in SegInfoByAddr
+                                        */
 };
 
 /* Internally used span info struct */
@@ -394,7 +625,7 @@ struct SymInfo {
     Collection*         CheapLocals;    /* List of cheap local symbols */
     Collection          DefLineInfoList;/* Line info of symbol definition */
     Collection          RefLineInfoList;/* Line info of symbol references */
-    char                Name[1];        /* Name of symbol */
+    const char*         Name;           /* Name of symbol */
 };
 
 /* Internally used type info struct */
@@ -480,12 +711,103 @@ static void xfree (void* Block)
 
 
 
+static Arena* NewArena (void)
+/* Create a new empty arena and return it */
+{
+    Arena* A = xmalloc (sizeof (Arena));
+    A->Blocks = 0;
+    A->Pos    = 0;
+    A->End    = 0;
+    A->Next   = 0;
+    return A;
+}
+
+
+
+static void* ArenaAlloc (Arena* A, size_t Size)
+/* Allocate Size bytes from the arena. The memory is freed by FreeArena. */
+{
+    char* P;
+
+    /* Round up so the next allocation is aligned */
+    Size = (Size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+
+    /* Get a new block if the current one is too small. Large requests get a
+    ** block of their own that is placed behind the current block, so the
+    ** rest of the current block is not wasted.
+    */
+    if (Size > (size_t) (A->End - A->Pos)) {
+        size_t      BlockSize = (Size > ARENA_BLOCK_SIZE / 4)? Size : ARENA_BLOCK_SIZE;
+        ArenaBlock* B = xmalloc (sizeof (ArenaBlock) + BlockSize);
+        P = (char*) (B + 1);
+        if (BlockSize == Size && A->Blocks) {
+            B->Next = A->Blocks->Next;
+            A->Blocks->Next = B;
+            return P;
+        }
+        B->Next   = A->Blocks;
+        A->Blocks = B;
+        A->Pos    = P;
+        A->End    = P + BlockSize;
+    }
+
+    /* Take the memory from the current block */
+    P = A->Pos;
+    A->Pos += Size;
+    return P;
+}
+
+
+
+static void ArenaMerge (Arena* Target, Arena* Source)
+/* Make Target the owner of Source, so Source is freed together with Target.
+** Source stays valid, so collections that allocate from it remain usable.
+*/
+{
+    Arena* Last = Source;
+    while (Last->Next) {
+        Last = Last->Next;
+    }
+    Last->Next   = Target->Next;
+    Target->Next = Source;
+}
+
+
+
+static void FreeArena (Arena* A)
+/* Free an arena, all memory allocated from it and all arenas merged into it */
+{
+    while (A) {
+        Arena* Next = A->Next;
+        while (A->Blocks) {
+            ArenaBlock* B = A->Blocks;
+            A->Blocks = B->Next;
+            xfree (B);
+        }
+        xfree (A);
+        A = Next;
+    }
+}
+
+
+
 /*****************************************************************************/
 /*                              Dynamic strings                              */
 /*****************************************************************************/
 
 
 
+static StrBuf* SB_Init (StrBuf* B)
+/* Initialize a string buffer */
+{
+    B->Buf       = 0;
+    B->Len       = 0;
+    B->Allocated = 0;
+    return B;
+}
+
+
+
 static void SB_Done (StrBuf* B)
 /* Free the data of a string buffer (but not the struct itself) */
 {
@@ -594,20 +916,6 @@ static char SB_At (const StrBuf* B, unsigned Pos)
 
 
 
-static void SB_Terminate (StrBuf* B)
-/* Zero terminate the given string buffer. NOTE: The terminating zero is not
-** accounted for in B->Len, if you want that, you have to use AppendChar!
-*/
-{
-    unsigned NewLen = B->Len + 1;
-    if (NewLen > B->Allocated) {
-        SB_Realloc (B, NewLen);
-    }
-    B->Buf[B->Len] = '\0';
-}
-
-
-
 static void SB_Clear (StrBuf* B)
 /* Clear the string buffer (make it empty) */
 {
@@ -630,43 +938,235 @@ static void SB_CopyBuf (StrBuf* Target, const char* Buf, unsigned Size)
 
 
 
-static void SB_Copy (StrBuf* Target, const StrBuf* Source)
-/* Copy Source to Target, discarding the old contents of Target */
+static void SB_AppendChar (StrBuf* B, int C)
+/* Append a character to a string buffer */
 {
-    SB_CopyBuf (Target, Source->Buf, Source->Len);
+    unsigned NewLen = B->Len + 1;
+    if (NewLen > B->Allocated) {
+        SB_Realloc (B, NewLen);
+    }
+    B->Buf[B->Len] = (char) C;
+    B->Len = NewLen;
 }
 
 
 
-static void SB_AppendChar (StrBuf* B, int C)
-/* Append a character to a string buffer */
+static void SB_AppendBuf (StrBuf* B, const char* S, unsigned Size)
+/* Append a character buffer to another string buffer */
 {
-    unsigned NewLen = B->Len + 1;
+    unsigned NewLen = B->Len + Size;
     if (NewLen > B->Allocated) {
         SB_Realloc (B, NewLen);
     }
-    B->Buf[B->Len] = (char) C;
+    memcpy (B->Buf + B->Len, S, Size);
     B->Len = NewLen;
 }
 
 
 
-static char* SB_StrDup (const StrBuf* B)
-/* Return the contents of B as a dynamically allocated string. The string
-** will always be NUL terminated.
+/*****************************************************************************/
+/*                                String pool                                */
+/*****************************************************************************/
+
+
+
+static void InitStrPool (StrPool* P)
+/* Initialize an empty string pool */
+{
+    P->Count = 0;
+    P->Size  = 0;
+    P->Tab   = 0;
+}
+
+
+
+static void DoneStrPool (StrPool* P)
+/* Free the hash table of a string pool. The strings themselves live in an
+** arena.
 */
 {
-    /* Allocate memory */
-    char* S = xmalloc (B->Len + 1);
+    xfree (P->Tab);
+    InitStrPool (P);
+}
 
-    /* Copy the string */
-    memcpy (S, B->Buf, B->Len);
 
-    /* Terminate it */
-    S[B->Len] = '\0';
 
-    /* And return the result */
-    return S;
+static unsigned HashStr (const char* S, unsigned Len)
+/* Return a hash value for the Len characters in S (FNV-1a) */
+{
+    unsigned H = 2166136261U;
+    while (Len--) {
+        H = (H ^ (unsigned char) *S++) * 16777619U;
+    }
+    return H;
+}
+
+
+
+static const PoolStr* SP_Lookup (const StrPool* P, const char* S, unsigned Len,
+                                 unsigned Hash, unsigned* Slot)
+/* Search for a string in the pool. Return the entry or NULL if the string is
+** not in the pool. Slot is set to the hash table slot where the string is or
+** should be inserted.
+*/
+{
+    unsigned I = Hash & (P->Size - 1);
+    while (P->Tab[I]) {
+        const PoolStr* E = P->Tab[I];
+        if (E->Hash == Hash && E->Len == Len && memcmp (E->Str, S, Len) == 0) {
+            *Slot = I;
+            return E;
+        }
+        I = (I + 1) & (P->Size - 1);
+    }
+    *Slot = I;
+    return 0;
+}
+
+
+
+static void SP_Grow (StrPool* P)
+/* Double the size of the hash table */
+{
+    unsigned  I;
+    unsigned  OldSize = P->Size;
+    PoolStr** OldTab  = P->Tab;
+
+    P->Size = OldSize? OldSize * 2 : 256;
+    P->Tab  = xmalloc (P->Size * sizeof (PoolStr*));
+    memset (P->Tab, 0, P->Size * sizeof (PoolStr*));
+    for (I = 0; I < OldSize; ++I) {
+        if (OldTab[I]) {
+            unsigned J = OldTab[I]->Hash & (P->Size - 1);
+            while (P->Tab[J]) {
+                J = (J + 1) & (P->Size - 1);
+            }
+            P->Tab[J] = OldTab[I];
+        }
+    }
+    xfree (OldTab);
+}
+
+
+
+static const char* SP_Add (StrPool* P, Arena* A, const char* S, unsigned Len)
+/* Add the Len characters in S to the pool if they're not already there. New
+** strings are allocated from A. Return the pooled, terminated string.
+*/
+{
+    unsigned Hash = HashStr (S, Len);
+    unsigned Slot;
+    PoolStr* E;
+
+    /* Keep the hash table at most half full */
+    if (2 * (P->Count + 1) > P->Size) {
+        SP_Grow (P);
+    }
+
+    /* Search for the string */
+    E = (PoolStr*) SP_Lookup (P, S, Len, Hash, &Slot);
+    if (E == 0) {
+        /* Not found, add it */
+        E = ArenaAlloc (A, sizeof (PoolStr) + Len);
+        E->Id   = P->Count++;
+        E->Hash = Hash;
+        E->Len  = Len;
+        memcpy (E->Str, S, Len);
+        E->Str[Len] = '\0';
+        P->Tab[Slot] = E;
+    }
+    return E->Str;
+}
+
+
+
+static const char* SP_Adopt (StrPool* P, const char* Name)
+/* Add a string from another pool to P. If P doesn't contain the string, the
+** entry is moved over without copying, so the memory of the other pool must
+** live as long as P. Return the pooled string.
+*/
+{
+    PoolStr* E = (PoolStr*) (Name - offsetof (PoolStr, Str));
+    unsigned Slot;
+    const PoolStr* Found;
+
+    /* Keep the hash table at most half full */
+    if (2 * (P->Count + 1) > P->Size) {
+        SP_Grow (P);
+    }
+
+    /* Search for the string */
+    Found = SP_Lookup (P, E->Str, E->Len, E->Hash, &Slot);
+    if (Found) {
+        return Found->Str;
+    }
+
+    /* Not found, take over the entry */
+    E->Id = P->Count++;
+    P->Tab[Slot] = E;
+    return E->Str;
+}
+
+
+
+static const PoolStr* SP_Find (const StrPool* P, const char* S)
+/* Return the pool entry for the string S or NULL if S is not in the pool */
+{
+    unsigned Len = strlen (S);
+    unsigned Slot;
+    if (P->Count == 0) {
+        return 0;
+    }
+    return SP_Lookup (P, S, Len, HashStr (S, Len), &Slot);
+}
+
+
+
+static const PoolStr* PoolEntry (const char* Name)
+/* Return the pool entry for a pooled string */
+{
+    return (const PoolStr*) (Name - offsetof (PoolStr, Str));
+}
+
+
+
+static int ComparePoolStr (const void* L, const void* R)
+/* Helper function to sort pool entries by their strings */
+{
+    return strcmp ((*(const PoolStr* const*) L)->Str,
+                   (*(const PoolStr* const*) R)->Str);
+}
+
+
+
+static void SP_Rank (StrPool* P)
+/* Renumber the strings in the pool in alphabetical order, so comparing the
+** ids is the same as comparing the strings.
+*/
+{
+    unsigned  I, J;
+    PoolStr** List = xmalloc (P->Count * sizeof (PoolStr*));
+
+    for (I = 0, J = 0; I < P->Size; ++I) {
+        if (P->Tab[I]) {
+            List[J++] = P->Tab[I];
+        }
+    }
+    qsort (List, P->Count, sizeof (PoolStr*), ComparePoolStr);
+    for (I = 0; I < P->Count; ++I) {
+        List[I]->Id = I;
+    }
+    xfree (List);
+}
+
+
+
+static int CompareNames (const char* L, const char* R)
+/* Compare two names from a ranked pool like strcmp does */
+{
+    unsigned LId = PoolEntry (L)->Id;
+    unsigned RId = PoolEntry (R)->Id;
+    return (LId < RId)? -1 : (LId > RId);
 }
 
 
@@ -684,6 +1184,7 @@ static Collection* CollInit (Collection* C)
     C->Count = 0;
     C->Size  = 0;
     C->Items = 0;
+    C->A     = 0;
 
     /* Return the new struct */
     return C;
@@ -691,10 +1192,21 @@ static Collection* CollInit (Collection* C)
 
 
 
-static Collection* CollNew (void)
-/* Allocate a new collection, initialize and return it */
+static Collection* CollInitArena (Collection* C, Arena* A)
+/* Initialize a collection that allocates its items from the arena A and
+** return it. Such a collection is freed together with the arena.
+*/
+{
+    CollInit (C)->A = A;
+    return C;
+}
+
+
+
+static Collection* CollNew (Arena* A)
+/* Allocate a new collection from the arena A, initialize and return it */
 {
-    return CollInit (xmalloc (sizeof (Collection)));
+    return CollInitArena (ArenaAlloc (A, sizeof (Collection)), A);
 }
 
 
@@ -705,7 +1217,9 @@ static void CollDone (Collection* C)
 */
 {
     /* Free the pointer array */
-    xfree (C->Items);
+    if (C->A == 0) {
+        xfree (C->Items);
+    }
 
     /* Clear the fields, so the collection may be reused (or CollDone called)
     ** again
@@ -717,18 +1231,6 @@ static void CollDone (Collection* C)
 
 
 
-static void CollFree (Collection* C)
-/* Free a dynamically allocated collection */
-{
-    /* Accept NULL pointers */
-    if (C) {
-        xfree (C->Items);
-        xfree (C);
-    }
-}
-
-
-
 static unsigned CollCount (const Collection* C)
 /* Return the number of items in the collection. Return 0 if C is NULL. */
 {
@@ -737,26 +1239,6 @@ static unsigned CollCount (const Collection* C)
 
 
 
-static void CollMove (Collection* Source, Collection* Target)
-/* Move all data from one collection to another. This function will first free
-** the data in the target collection, and - after the move - clear the data
-** from the source collection.
-*/
-{
-    /* Free the target collection data */
-    xfree (Target->Items);
-
-    /* Now copy the whole bunch over */
-    *Target = *Source;
-
-    /* Empty Source */
-    Source->Count = 0;
-    Source->Size  = 0;
-    Source->Items = 0;
-}
-
-
-
 static void CollGrow (Collection* C, unsigned Size)
 /* Grow the collection C so it is able to hold Size items without a resize
 ** being necessary. This can be called for performance reasons if the number
@@ -770,11 +1252,18 @@ static void CollGrow (Collection* C, unsigned Size)
         return;
     }
 
-    /* Grow the collection */
+    /* Grow the collection. The old array of a collection in an arena is
+    ** released with the arena.
+    */
     C->Size = Size;
-    NewItems = xmalloc (C->Size * sizeof (CollEntry));
-    memcpy (NewItems, C->Items, C->Count * sizeof (CollEntry));
-    xfree (C->Items);
+    if (C->A) {
+        NewItems = ArenaAlloc (C->A, C->Size * sizeof (CollEntry));
+        memcpy (NewItems, C->Items, C->Count * sizeof (CollEntry));
+    } else {
+        NewItems = xmalloc (C->Size * sizeof (CollEntry));
+        memcpy (NewItems, C->Items, C->Count * sizeof (CollEntry));
+        xfree (C->Items);
+    }
     C->Items = NewItems;
 }
 
@@ -888,6 +1377,25 @@ static void CollAppendId (Collection* C, unsigned Id)
 
 
 
+static void CollDeleteAll (Collection* C)
+/* Remove all items from a collection */
+{
+    C->Count = 0;
+}
+
+
+
+static void CollCopy (Collection* Target, const Collection* Source)
+/* Copy all items from Source to Target, replacing the contents of Target */
+{
+    CollDeleteAll (Target);
+    CollGrow (Target, Source->Count);
+    memcpy (Target->Items, Source->Items, Source->Count * sizeof (CollEntry));
+    Target->Count = Source->Count;
+}
+
+
+
 static void* CollAt (const Collection* C, unsigned Index)
 /* Return the item at the given index */
 {
@@ -912,57 +1420,320 @@ static unsigned CollIdAt (const Collection* C, unsigned Index)
 
 
 
-static void CollQuickSort (Collection* C, int Lo, int Hi,
-                           int (*Compare) (const void*, const void*))
-/* Internal recursive sort function. */
+static void CollInsertionSort (CollEntry* Items, int Lo, int Hi,
+                               int (*Compare) (const void*, const void*))
+/* Sort the items from Lo to Hi, used for short ranges */
 {
-    /* Get a pointer to the items */
-    CollEntry* Items = C->Items;
-
-    /* Quicksort */
-    while (Hi > Lo) {
-        int I = Lo + 1;
-        int J = Hi;
-        while (I <= J) {
-            while (I <= J && Compare (Items[Lo].Ptr, Items[I].Ptr) >= 0) {
-                ++I;
-            }
-            while (I <= J && Compare (Items[Lo].Ptr, Items[J].Ptr) < 0) {
-                --J;
-            }
-            if (I <= J) {
-                /* Swap I and J */
-                CollEntry Tmp = Items[I];
-                Items[I]  = Items[J];
-                Items[J]  = Tmp;
-                ++I;
-                --J;
-            }
-        }
-        if (J != Lo) {
-            /* Swap J and Lo */
-            CollEntry Tmp = Items[J];
-            Items[J]  = Items[Lo];
-            Items[Lo] = Tmp;
-        }
-        if (J > (Hi + Lo) / 2) {
-            CollQuickSort (C, J + 1, Hi, Compare);
-            Hi = J - 1;
-        } else {
-            CollQuickSort (C, Lo, J - 1, Compare);
-            Lo = J + 1;
+    int I, J;
+    for (I = Lo + 1; I <= Hi; ++I) {
+        CollEntry Tmp = Items[I];
+        for (J = I; J > Lo && Compare (Items[J-1].Ptr, Tmp.Ptr) > 0; --J) {
+            Items[J] = Items[J-1];
         }
+        Items[J] = Tmp;
     }
 }
 
 
 
-static void CollSort (Collection* C, int (*Compare) (const void*, const void*))
-/* Sort the collection using the given compare function. */
+static void CollSiftDown (CollEntry* Items, int Root, int Count,
+                          int (*Compare) (const void*, const void*))
+/* Move the item at Root of a heap with Count items down to its place */
 {
-    if (C->Count > 1) {
-        CollQuickSort (C, 0, C->Count-1, Compare);
+    CollEntry Tmp = Items[Root];
+    int Child;
+    while ((Child = 2 * Root + 1) < Count) {
+        if (Child + 1 < Count && Compare (Items[Child].Ptr, Items[Child+1].Ptr) < 0) {
+            ++Child;
+        }
+        if (Compare (Tmp.Ptr, Items[Child].Ptr) >= 0) {
+            break;
+        }
+        Items[Root] = Items[Child];
+        Root = Child;
+    }
+    Items[Root] = Tmp;
+}
+
+
+
+static void CollHeapSort (CollEntry* Items, int Count,
+                          int (*Compare) (const void*, const void*))
+/* Sort Count items with heapsort, used if quicksort doesn't make progress */
+{
+    int I;
+    for (I = Count / 2 - 1; I >= 0; --I) {
+        CollSiftDown (Items, I, Count, Compare);
+    }
+    for (I = Count - 1; I > 0; --I) {
+        CollEntry Tmp = Items[0];
+        Items[0] = Items[I];
+        Items[I] = Tmp;
+        CollSiftDown (Items, 0, I, Compare);
+    }
+}
+
+
+
+static void CollIntroSort (CollEntry* Items, int Lo, int Hi, unsigned Depth,
+                           int (*Compare) (const void*, const void*))
+/* Internal recursive sort function. Quicksort with a median of three pivot,
+** which switches to heapsort after Depth levels of partitioning, so the
+** worst case is O(n log n). Short ranges are left to insertion sort.
+*/
+{
+    while (Hi - Lo > 16) {
+
+        CollEntry Pivot;
+        CollEntry Tmp;
+        int Mid = Lo + (Hi - Lo) / 2;
+        int I, J;
+
+        /* Use heapsort if the partitions are bad too often */
+        if (Depth-- == 0) {
+            CollHeapSort (Items + Lo, Hi - Lo + 1, Compare);
+            return;
+        }
+
+        /* Sort the first, middle and last item, and use the middle one as
+        ** pivot. The first and last item then stop the scans below.
+        */
+        if (Compare (Items[Mid].Ptr, Items[Lo].Ptr) < 0) {
+            Tmp = Items[Mid]; Items[Mid] = Items[Lo]; Items[Lo] = Tmp;
+        }
+        if (Compare (Items[Hi].Ptr, Items[Mid].Ptr) < 0) {
+            Tmp = Items[Hi]; Items[Hi] = Items[Mid]; Items[Mid] = Tmp;
+            if (Compare (Items[Mid].Ptr, Items[Lo].Ptr) < 0) {
+                Tmp = Items[Mid]; Items[Mid] = Items[Lo]; Items[Lo] = Tmp;
+            }
+        }
+        Pivot = Items[Mid];
+
+        /* Partition. Items equal to the pivot stop both scans, so runs of
+        ** equal items are split in the middle.
+        */
+        I = Lo;
+        J = Hi;
+        while (1) {
+            while (Compare (Items[++I].Ptr, Pivot.Ptr) < 0) {
+            }
+            while (Compare (Pivot.Ptr, Items[--J].Ptr) < 0) {
+            }
+            if (I >= J) {
+                break;
+            }
+            Tmp = Items[I]; Items[I] = Items[J]; Items[J] = Tmp;
+        }
+
+        /* Recurse into the smaller part, loop for the larger one */
+        if (J - Lo < Hi - J) {
+            CollIntroSort (Items, Lo, J, Depth, Compare);
+            Lo = J + 1;
+        } else {
+            CollIntroSort (Items, J + 1, Hi, Depth, Compare);
+            Hi = J;
+        }
+    }
+    CollInsertionSort (Items, Lo, Hi, Compare);
+}
+
+
+
+static void CollSort (Collection* C, int (*Compare) (const void*, const void*))
+/* Sort the collection using the given compare function. */
+{
+    if (C->Count > 1) {
+        /* Allow twice the depth of a perfectly balanced quicksort */
+        unsigned Depth = 0;
+        unsigned Count;
+        for (Count = C->Count; Count > 1; Count >>= 1) {
+            Depth += 2;
+        }
+        CollIntroSort (C->Items, 0, C->Count-1, Depth, Compare);
+    }
+}
+
+
+
+static void CollSortByKey (Collection* C, CollKey* Keys)
+/* Sort the collection by numeric keys. Keys must have one entry for each
+** item, with the item in Ptr. The sort is stable and doesn't call a compare
+** function: It is an LSD radix sort on the bytes of the keys, that skips
+** bytes that are the same in all keys. The contents of Keys is destroyed.
+*/
+{
+    unsigned  Counts[8][256];
+    CollKey*  Buf;
+    CollKey*  Src;
+    CollKey*  Dst;
+    unsigned  I, Pass;
+
+    if (C->Count < 2) {
+        return;
+    }
+
+    /* Count the values of all bytes in one go */
+    memset (Counts, 0, sizeof (Counts));
+    for (I = 0; I < C->Count; ++I) {
+        unsigned Lo = Keys[I].Lo;
+        unsigned Hi = Keys[I].Hi;
+        ++Counts[0][Lo & 0xFF];
+        ++Counts[1][(Lo >> 8) & 0xFF];
+        ++Counts[2][(Lo >> 16) & 0xFF];
+        ++Counts[3][(Lo >> 24) & 0xFF];
+        ++Counts[4][Hi & 0xFF];
+        ++Counts[5][(Hi >> 8) & 0xFF];
+        ++Counts[6][(Hi >> 16) & 0xFF];
+        ++Counts[7][(Hi >> 24) & 0xFF];
+    }
+
+    /* Distribute by each byte, starting with the least significant one */
+    Buf = xmalloc (C->Count * sizeof (CollKey));
+    Src = Keys;
+    Dst = Buf;
+    for (Pass = 0; Pass < 8; ++Pass) {
+
+        unsigned  Shift = (Pass & 3) * 8;
+        unsigned* Count = Counts[Pass];
+        unsigned  Pos = 0;
+        CollKey*  Tmp;
+
+        /* Nothing to do if all keys have the same byte here */
+        if (Count[(((Pass < 4)? Src[0].Lo : Src[0].Hi) >> Shift) & 0xFF] == C->Count) {
+            continue;
+        }
+
+        /* Turn the counts into start positions */
+        for (I = 0; I < 256; ++I) {
+            unsigned N = Count[I];
+            Count[I] = Pos;
+            Pos += N;
+        }
+
+        /* Move the keys */
+        for (I = 0; I < C->Count; ++I) {
+            unsigned Key = (Pass < 4)? Src[I].Lo : Src[I].Hi;
+            Dst[Count[(Key >> Shift) & 0xFF]++] = Src[I];
+        }
+        Tmp = Src;
+        Src = Dst;
+        Dst = Tmp;
     }
+
+    /* Store the items in their new order */
+    for (I = 0; I < C->Count; ++I) {
+        C->Items[I].Ptr = Src[I].Ptr;
+    }
+    xfree (Buf);
+}
+
+
+
+/*****************************************************************************/
+/*                                Name indexes                               */
+/*****************************************************************************/
+
+
+
+static void InitNameIndex (NameIndex* I)
+/* Initialize an empty name index */
+{
+    I->Size = 0;
+    I->Tab  = 0;
+}
+
+
+
+static void DoneNameIndex (NameIndex* I)
+/* Free the hash table of a name index */
+{
+    xfree (I->Tab);
+    InitNameIndex (I);
+}
+
+
+
+static unsigned HashNameId (unsigned Id)
+/* Return a hash value for the id of a name */
+{
+    Id *= 0x9E3779B1U;
+    return Id ^ (Id >> 16);
+}
+
+
+
+static void CreateNameIndex (NameIndex* I, const Collection* C, size_t NameOffs)
+/* Create the index for a collection sorted by name. NameOffs is the offset
+** of the name pointer in the items. The names must be pooled.
+*/
+{
+    unsigned    Groups = 0;
+    const char* Last   = 0;
+    NameGroup*  G;
+    unsigned    J;
+
+    /* Count the groups of items with equal names */
+    for (J = 0; J < CollCount (C); ++J) {
+        const char* Name = *(const char**) ((const char*) CollAt (C, J) + NameOffs);
+        if (Name != Last) {
+            ++Groups;
+            Last = Name;
+        }
+    }
+    if (Groups == 0) {
+        return;
+    }
+
+    /* Keep the table at most half full */
+    I->Size = 8;
+    while (I->Size < 2 * Groups) {
+        I->Size *= 2;
+    }
+    I->Tab = xmalloc (I->Size * sizeof (NameGroup));
+    memset (I->Tab, 0, I->Size * sizeof (NameGroup));
+
+    /* Enter the groups */
+    Last = 0;
+    G    = 0;
+    for (J = 0; J < CollCount (C); ++J) {
+        const char* Name = *(const char**) ((const char*) CollAt (C, J) + NameOffs);
+        if (Name != Last) {
+            unsigned Id = PoolEntry (Name)->Id;
+            unsigned K  = HashNameId (Id) & (I->Size - 1);
+            while (I->Tab[K].Count) {
+                K = (K + 1) & (I->Size - 1);
+            }
+            G = &I->Tab[K];
+            G->Name  = Id;
+            G->First = J;
+            Last = Name;
+        }
+        ++G->Count;
+    }
+}
+
+
+
+static const NameGroup* FindNameGroup (const NameIndex* I, const char* Name)
+/* Return the group of items with the given pooled name, or NULL if there
+** are none.
+*/
+{
+    unsigned Id;
+    unsigned K;
+
+    if (I->Size == 0) {
+        return 0;
+    }
+    Id = PoolEntry (Name)->Id;
+    K  = HashNameId (Id) & (I->Size - 1);
+    while (I->Tab[K].Count) {
+        if (I->Tab[K].Name == Id) {
+            return &I->Tab[K];
+        }
+        K = (K + 1) & (I->Size - 1);
+    }
+    return 0;
 }
 
 
@@ -1024,19 +1795,19 @@ static void DumpOneLineInfo (unsigned Num, LineInfo* LI)
 static void DumpSpanInfo (SpanInfoList* L)
 /* Dump a list of span infos */
 {
-    unsigned I, J;
+    unsigned I;
 
-    /* Line info */
+    /* Span info */
     for (I = 0; I < L->Count; ++I) {
         const SpanInfoListEntry* E = &L->List[I];
-        printf ("Addr:   %lu\n", (unsigned long) E->Addr);
-        if (E->Count == 1) {
-            DumpOneLineInfo (0, E->Data);
-        } else {
-            for (J = 0; J < E->Count; ++J) {
-                DumpOneLineInfo (J, ((LineInfo**) E->Data)[J]);
-            }
-        }
+        printf ("Span:   %u\n"
+                "  Start:  %lu\n"
+                "  End:    %lu\n"
+                "  MaxEnd: %lu\n",
+                E->Span->Id,
+                (unsigned long) E->Start,
+                (unsigned long) E->End,
+                (unsigned long) E->MaxEnd);
     }
 }
 
@@ -1083,6 +1854,44 @@ static unsigned GetId (const void* Data)
 
 
 
+static cc65_view MakeView (const Collection* C, unsigned First, unsigned Count)
+/* Return a view of Count items of a collection, starting with item First */
+{
+    cc65_view V;
+    V.count = Count;
+    V.priv  = Count? C->Items + First : 0;
+    return V;
+}
+
+
+
+static cc65_view CollView (const Collection* C)
+/* Return a view of all items of a collection */
+{
+    return MakeView (C, 0, CollCount (C));
+}
+
+
+
+static cc65_view ItemView (const Collection* C, unsigned Id)
+/* Return a view of the item with the given id from a collection sorted by
+** id. The view is empty if there is no such item.
+*/
+{
+    return MakeView (C, Id, Id < CollCount (C));
+}
+
+
+
+static const void* ViewAt (const cc65_view* V, unsigned Index)
+/* Return an item from a view */
+{
+    assert (Index < V->count);
+    return ((const CollEntry*) V->priv)[Index].Ptr;
+}
+
+
+
 static unsigned HexValue (char C)
 /* Convert the ascii representation of a hex nibble into the hex nibble */
 {
@@ -1121,11 +1930,15 @@ static void ParseError (InputData* D, cc65_error_severity Type, const char* Msg,
     vsnprintf (E->errormsg, MsgSize+1, Msg, ap);
     va_end (ap);
 
-    /* Call the caller:-) */
-    D->Error (E);
-
-    /* Free the data structure */
-    xfree (E);
+    /* Call the caller:-) Worker threads keep the error and the main thread
+    ** will report it after fixing the line number.
+    */
+    if (D->Deferred) {
+        CollAppend (D->Deferred, E);
+    } else {
+        D->Error (E);
+        xfree (E);
+    }
 
     /* Count errors */
     if (Type == CC65_ERROR) {
@@ -1161,8 +1974,8 @@ static void UnknownKeyword (InputData* D)
 */
 {
     /* Output a warning */
-    ParseError (D, CC65_WARNING, "Unknown keyword \"%s\" - skipping",
-                SB_GetConstBuf (&D->SVal));
+    ParseError (D, CC65_WARNING, "Unknown keyword \"%.*s\" - skipping",
+                (int) D->SVal.Len, D->SVal.Ptr);
 
     /* Skip the identifier */
     NextToken (D);
@@ -1189,14 +2002,14 @@ static void UnknownKeyword (InputData* D)
 
 
 
-static CSymInfo* NewCSymInfo (const StrBuf* Name)
+static CSymInfo* NewCSymInfo (Arena* A, const char* Name)
 /* Create a new CSymInfo struct and return it */
 {
     /* Allocate memory */
-    CSymInfo* S = xmalloc (sizeof (CSymInfo) + SB_GetLen (Name));
+    CSymInfo* S = ArenaAlloc (A, sizeof (CSymInfo));
 
     /* Initialize it */
-    memcpy (S->Name, SB_GetConstBuf (Name), SB_GetLen (Name) + 1);
+    S->Name = Name;
 
     /* Return it */
     return S;
@@ -1204,15 +2017,6 @@ static CSymInfo* NewCSymInfo (const StrBuf* Name)
 
 
 
-static void FreeCSymInfo (CSymInfo* S)
-/* Free a CSymInfo struct */
-{
-    /* Free the structure itself */
-    xfree (S);
-}
-
-
-
 static cc65_csyminfo* new_cc65_csyminfo (unsigned Count)
 /* Allocate and return a cc65_csyminfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1245,7 +2049,7 @@ static int CompareCSymInfoByName (const void* L, const void* R)
 /* Helper function to sort c symbol infos in a collection by name */
 {
     /* Sort by symbol name, then by id */
-    int Res = strcmp (((const CSymInfo*) L)->Name, ((const CSymInfo*) R)->Name);
+    int Res = CompareNames (((const CSymInfo*) L)->Name, ((const CSymInfo*) R)->Name);
     if (Res == 0) {
         Res = (int)((const CSymInfo*) L)->Id - (int)((const CSymInfo*) R)->Id;
     }
@@ -1260,16 +2064,16 @@ static int CompareCSymInfoByName (const void* L, const void* R)
 
 
 
-static FileInfo* NewFileInfo (const StrBuf* Name)
+static FileInfo* NewFileInfo (Arena* A, const char* Name)
 /* Create a new FileInfo struct and return it */
 {
     /* Allocate memory */
-    FileInfo* F = xmalloc (sizeof (FileInfo) + SB_GetLen (Name));
+    FileInfo* F = ArenaAlloc (A, sizeof (FileInfo));
 
     /* Initialize it */
-    CollInit (&F->ModInfoByName);
-    CollInit (&F->LineInfoByLine);
-    memcpy (F->Name, SB_GetConstBuf (Name), SB_GetLen (Name) + 1);
+    CollInitArena (&F->ModInfoByName, A);
+    CollInitArena (&F->LineInfoByLine, A);
+    F->Name = Name;
 
     /* Return it */
     return F;
@@ -1277,19 +2081,6 @@ static FileInfo* NewFileInfo (const StrBuf* Name)
 
 
 
-static void FreeFileInfo (FileInfo* F)
-/* Free a FileInfo struct */
-{
-    /* Delete the collections */
-    CollDone (&F->ModInfoByName);
-    CollDone (&F->LineInfoByLine);
-
-    /* Free the file info structure itself */
-    xfree (F);
-}
-
-
-
 static cc65_sourceinfo* new_cc65_sourceinfo (unsigned Count)
 /* Allocate and return a cc65_sourceinfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1318,11 +2109,11 @@ static int CompareFileInfoByName (const void* L, const void* R)
 /* Helper function to sort file infos in a collection by name */
 {
     /* Sort by file name. If names are equal, sort by timestamp,
-    ** then sort by size. Which means, identical files will go
-    ** together.
+    ** then sort by size, then by id. Which means, identical files
+    ** will go together.
     */
-    int Res = strcmp (((const FileInfo*) L)->Name,
-                      ((const FileInfo*) R)->Name);
+    int Res = CompareNames (((const FileInfo*) L)->Name,
+                            ((const FileInfo*) R)->Name);
     if (Res != 0) {
         return Res;
     }
@@ -1336,7 +2127,7 @@ static int CompareFileInfoByName (const void* L, const void* R)
     } else if (((const FileInfo*) L)->Size < ((const FileInfo*) R)->Size) {
         return -1;
     } else {
-        return 0;
+        return (int)((const FileInfo*) L)->Id - (int)((const FileInfo*) R)->Id;
     }
 }
 
@@ -1348,14 +2139,14 @@ static int CompareFileInfoByName (const void* L, const void* R)
 
 
 
-static LibInfo* NewLibInfo (const StrBuf* Name)
+static LibInfo* NewLibInfo (Arena* A, const char* Name)
 /* Create a new LibInfo struct, initialize and return it */
 {
     /* Allocate memory */
-    LibInfo* L = xmalloc (sizeof (LibInfo) + SB_GetLen (Name));
+    LibInfo* L = ArenaAlloc (A, sizeof (LibInfo));
 
     /* Initialize the name */
-    memcpy (L->Name, SB_GetConstBuf (Name), SB_GetLen (Name) + 1);
+    L->Name = Name;
 
     /* Return it */
     return L;
@@ -1363,14 +2154,6 @@ static LibInfo* NewLibInfo (const StrBuf* Name)
 
 
 
-static void FreeLibInfo (LibInfo* L)
-/* Free a LibInfo struct */
-{
-    xfree (L);
-}
-
-
-
 static cc65_libraryinfo* new_cc65_libraryinfo (unsigned Count)
 /* Allocate and return a cc65_libraryinfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1399,28 +2182,19 @@ static void CopyLibInfo (cc65_librarydata* D, const LibInfo* L)
 
 
 
-static LineInfo* NewLineInfo (void)
+static LineInfo* NewLineInfo (Arena* A)
 /* Create a new LineInfo struct and return it */
 {
     /* Allocate memory */
-    LineInfo* L = xmalloc (sizeof (LineInfo));
+    LineInfo* L = ArenaAlloc (A, sizeof (LineInfo));
 
     /* Initialize and return it */
-    CollInit (&L->SpanInfoList);
+    CollInitArena (&L->SpanInfoList, A);
     return L;
 }
 
 
 
-static void FreeLineInfo (LineInfo* L)
-/* Free a LineInfo struct */
-{
-    CollDone (&L->SpanInfoList);
-    xfree (L);
-}
-
-
-
 static cc65_lineinfo* new_cc65_lineinfo (unsigned Count)
 /* Allocate and return a cc65_lineinfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1447,10 +2221,14 @@ static void CopyLineInfo (cc65_linedata* D, const LineInfo* L)
 
 
 static int CompareLineInfoByLine (const void* L, const void* R)
-/* Helper function to sort line infos in a collection by line. */
+/* Helper function to sort line infos in a collection by line, then by id. */
 {
     int Left  = ((const LineInfo*) L)->Line;
     int Right = ((const LineInfo*) R)->Line;
+    if (Left == Right) {
+        Left  = ((const LineInfo*) L)->Id;
+        Right = ((const LineInfo*) R)->Id;
+    }
     return Left - Right;
 }
 
@@ -1462,18 +2240,18 @@ static int CompareLineInfoByLine (const void* L, const void* R)
 
 
 
-static ModInfo* NewModInfo (const StrBuf* Name)
+static ModInfo* NewModInfo (Arena* A, const char* Name)
 /* Create a new ModInfo struct, initialize and return it */
 {
     /* Allocate memory */
-    ModInfo* M = xmalloc (sizeof (ModInfo) + SB_GetLen (Name));
+    ModInfo* M = ArenaAlloc (A, sizeof (ModInfo));
 
     /* Initialize it */
     M->MainScope = 0;
-    CollInit (&M->CSymFuncByName);
-    CollInit (&M->FileInfoByName);
-    CollInit (&M->ScopeInfoByName);
-    memcpy (M->Name, SB_GetConstBuf (Name), SB_GetLen (Name) + 1);
+    CollInitArena (&M->CSymFuncByName, A);
+    CollInitArena (&M->FileInfoByName, A);
+    CollInitArena (&M->ScopeInfoByName, A);
+    M->Name = Name;
 
     /* Return it */
     return M;
@@ -1481,20 +2259,6 @@ static ModInfo* NewModInfo (const StrBuf* Name)
 
 
 
-static void FreeModInfo (ModInfo* M)
-/* Free a ModInfo struct */
-{
-    /* Free the collections */
-    CollDone (&M->CSymFuncByName);
-    CollDone (&M->FileInfoByName);
-    CollDone (&M->ScopeInfoByName);
-
-    /* Free the structure itself */
-    xfree (M);
-}
-
-
-
 static cc65_moduleinfo* new_cc65_moduleinfo (unsigned Count)
 /* Allocate and return a cc65_moduleinfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1523,8 +2287,12 @@ static void CopyModInfo (cc65_moduledata* D, const ModInfo* M)
 static int CompareModInfoByName (const void* L, const void* R)
 /* Helper function to sort module infos in a collection by name */
 {
-    /* Compare module name */
-    return strcmp (((const ModInfo*) L)->Name, ((const ModInfo*) R)->Name);
+    /* Compare module name, then id */
+    int Res = CompareNames (((const ModInfo*) L)->Name, ((const ModInfo*) R)->Name);
+    if (Res == 0) {
+        Res = (int)((const ModInfo*) L)->Id - (int)((const ModInfo*) R)->Id;
+    }
+    return Res;
 }
 
 
@@ -1535,19 +2303,19 @@ static int CompareModInfoByName (const void* L, const void* R)
 
 
 
-static ScopeInfo* NewScopeInfo (const StrBuf* Name)
+static ScopeInfo* NewScopeInfo (Arena* A, const char* Name)
 /* Create a new ScopeInfo struct, initialize and return it */
 {
     /* Allocate memory */
-    ScopeInfo* S = xmalloc (sizeof (ScopeInfo) + SB_GetLen (Name));
+    ScopeInfo* S = ArenaAlloc (A, sizeof (ScopeInfo));
 
     /* Initialize the fields as necessary */
     S->CSymFunc = 0;
-    CollInit (&S->SpanInfoList);
-    CollInit (&S->SymInfoByName);
+    CollInitArena (&S->SpanInfoList, A);
+    CollInitArena (&S->SymInfoByName, A);
     S->CSymInfoByName = 0;
     S->ChildScopeList = 0;
-    memcpy (S->Name, SB_GetConstBuf (Name), SB_GetLen (Name) + 1);
+    S->Name = Name;
 
     /* Return it */
     return S;
@@ -1555,18 +2323,6 @@ static ScopeInfo* NewScopeInfo (const StrBuf* Name)
 
 
 
-static void FreeScopeInfo (ScopeInfo* S)
-/* Free a ScopeInfo struct */
-{
-    CollDone (&S->SpanInfoList);
-    CollDone (&S->SymInfoByName);
-    CollFree (S->CSymInfoByName);
-    CollFree (S->ChildScopeList);
-    xfree (S);
-}
-
-
-
 static cc65_scopeinfo* new_cc65_scopeinfo (unsigned Count)
 /* Allocate and return a cc65_scopeinfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1601,7 +2357,7 @@ static int CompareScopeInfoByName (const void* L, const void* R)
     const ScopeInfo* Right = R;
 
     /* Compare scope name, then id */
-    int Res = strcmp (Left->Name, Right->Name);
+    int Res = CompareNames (Left->Name, Right->Name);
     if (Res == 0) {
         Res = (int)Left->Id - (int)Right->Id;
     }
@@ -1616,28 +2372,30 @@ static int CompareScopeInfoByName (const void* L, const void* R)
 
 
 
-static SegInfo* NewSegInfo (const StrBuf* Name, unsigned Id,
+static SegInfo* NewSegInfo (Arena* A, const char* Name, unsigned Id,
                             cc65_addr Start, cc65_addr Size,
-                            const StrBuf* OutputName, unsigned long OutputOffs)
+                            const char* OutputName,
+                            unsigned long OutputOffs)
 /* Create a new SegInfo struct and return it */
 {
     /* Allocate memory */
-    SegInfo* S = xmalloc (sizeof (SegInfo) + SB_GetLen (Name));
+    SegInfo* S = ArenaAlloc (A, sizeof (SegInfo));
 
     /* Initialize it */
     S->Id         = Id;
     S->Start      = Start;
     S->Size       = Size;
-    if (SB_GetLen (OutputName) > 0) {
+    if (OutputName) {
         /* Output file given */
-        S->OutputName = SB_StrDup (OutputName);
+        S->OutputName = OutputName;
         S->OutputOffs = OutputOffs;
     } else {
         /* No output file given */
         S->OutputName = 0;
         S->OutputOffs = 0;
     }
-    memcpy (S->Name, SB_GetConstBuf (Name), SB_GetLen (Name) + 1);
+    S->Name = Name;
+    S->MaxEnd = 0;
 
     /* Return it */
     return S;
@@ -1645,15 +2403,6 @@ static SegInfo* NewSegInfo (const StrBuf* Name, unsigned Id,
 
 
 
-static void FreeSegInfo (SegInfo* S)
-/* Free a SegInfo struct */
-{
-    xfree (S->OutputName);
-    xfree (S);
-}
-
-
-
 static cc65_segmentinfo* new_cc65_segmentinfo (unsigned Count)
 /* Allocate and return a cc65_segmentinfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1683,9 +2432,27 @@ static void CopySegInfo (cc65_segmentdata* D, const SegInfo* S)
 static int CompareSegInfoByName (const void* L, const void* R)
 /* Helper function to sort segment infos in a collection by name */
 {
-    /* Sort by file name */
-    return strcmp (((const SegInfo*) L)->Name,
-                   ((const SegInfo*) R)->Name);
+    /* Sort by segment name, then id */
+    int Res = CompareNames (((const SegInfo*) L)->Name,
+                            ((const SegInfo*) R)->Name);
+    if (Res == 0) {
+        Res = (int)((const SegInfo*) L)->Id - (int)((const SegInfo*) R)->Id;
+    }
+    return Res;
+}
+
+
+
+static int CompareSegInfoByAddr (const void* L, const void* R)
+/* Helper function to sort segment infos in a collection by start address */
+{
+    /* Sort by start address, then id */
+    const SegInfo* Left  = L;
+    const SegInfo* Right = R;
+    if (Left->Start != Right->Start) {
+        return (Left->Start < Right->Start)? -1 : 1;
+    }
+    return (int) Left->Id - (int) Right->Id;
 }
 
 
@@ -1696,11 +2463,11 @@ static int CompareSegInfoByName (const void* L, const void* R)
 
 
 
-static SpanInfo* NewSpanInfo (void)
+static SpanInfo* NewSpanInfo (Arena* A)
 /* Create a new SpanInfo struct, initialize and return it */
 {
     /* Allocate memory */
-    SpanInfo* S = xmalloc (sizeof (SpanInfo));
+    SpanInfo* S = ArenaAlloc (A, sizeof (SpanInfo));
 
     /* Initialize and return it */
     S->ScopeInfoList = 0;
@@ -1710,16 +2477,6 @@ static SpanInfo* NewSpanInfo (void)
 
 
 
-static void FreeSpanInfo (SpanInfo* S)
-/* Free a SpanInfo struct */
-{
-    CollFree (S->ScopeInfoList);
-    CollFree (S->LineInfoList);
-    xfree (S);
-}
-
-
-
 static cc65_spaninfo* new_cc65_spaninfo (unsigned Count)
 /* Allocate and return a cc65_spaninfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1747,27 +2504,24 @@ static void CopySpanInfo (cc65_spandata* D, const SpanInfo* S)
 
 
 
-static int CompareSpanInfoByAddr (const void* L, const void* R)
-/* Helper function to sort span infos in a collection by address. Span infos
-** with smaller start address are considered smaller. If start addresses are
-** equal, line spans with smaller end address are considered smaller. This
-** means, that when CompareSpanInfoByAddr is used for sorting, a range with
-** identical start addresses will have smaller spans first, followed by
-** larger spans.
+static void SortSpanInfoByAddr (Collection* C)
+/* Sort span infos in a collection by address. Span infos with smaller start
+** address come first. If start addresses are equal, spans with smaller end
+** address come first. This means that a range with identical start addresses
+** will have smaller spans first, followed by larger spans. Spans with equal
+** addresses keep their order.
 */
 {
-    /* Sort by start of span */
-    if (((const SpanInfo*) L)->Start > ((const SpanInfo*) R)->Start) {
-        return 1;
-    } else if (((const SpanInfo*) L)->Start < ((const SpanInfo*) R)->Start) {
-        return -1;
-    } else if (((const SpanInfo*) L)->End > ((const SpanInfo*) R)->End) {
-        return 1;
-    } else if (((const SpanInfo*) L)->End < ((const SpanInfo*) R)->End) {
-        return -1;
-    } else {
-        return 0;
+    unsigned I;
+    CollKey* Keys = xmalloc (CollCount (C) * sizeof (CollKey));
+    for (I = 0; I < CollCount (C); ++I) {
+        SpanInfo* S = CollAt (C, I);
+        Keys[I].Hi  = S->Start;
+        Keys[I].Lo  = S->End;
+        Keys[I].Ptr = S;
     }
+    CollSortByKey (C, Keys);
+    xfree (Keys);
 }
 
 
@@ -1778,19 +2532,19 @@ static int CompareSpanInfoByAddr (const void* L, const void* R)
 
 
 
-static SymInfo* NewSymInfo (const StrBuf* Name)
+static SymInfo* NewSymInfo (Arena* A, const char* Name)
 /* Create a new SymInfo struct, initialize and return it */
 {
     /* Allocate memory */
-    SymInfo* S = xmalloc (sizeof (SymInfo) + SB_GetLen (Name));
+    SymInfo* S = ArenaAlloc (A, sizeof (SymInfo));
 
     /* Initialize it as necessary */
     S->CSym        = 0;
     S->ImportList  = 0;
     S->CheapLocals = 0;
-    CollInit (&S->DefLineInfoList);
-    CollInit (&S->RefLineInfoList);
-    memcpy (S->Name, SB_GetConstBuf (Name), SB_GetLen (Name) + 1);
+    CollInitArena (&S->DefLineInfoList, A);
+    CollInitArena (&S->RefLineInfoList, A);
+    S->Name = Name;
 
     /* Return it */
     return S;
@@ -1798,18 +2552,6 @@ static SymInfo* NewSymInfo (const StrBuf* Name)
 
 
 
-static void FreeSymInfo (SymInfo* S)
-/* Free a SymInfo struct */
-{
-    CollFree (S->ImportList);
-    CollFree (S->CheapLocals);
-    CollDone (&S->DefLineInfoList);
-    CollDone (&S->RefLineInfoList);
-    xfree (S);
-}
-
-
-
 static cc65_symbolinfo* new_cc65_symbolinfo (unsigned Count)
 /* Allocate and return a cc65_symbolinfo struct that is able to hold Count
 ** entries. Initialize the count field of the returned struct.
@@ -1864,9 +2606,13 @@ static void CopySymInfo (cc65_symboldata* D, const SymInfo* S)
 static int CompareSymInfoByName (const void* L, const void* R)
 /* Helper function to sort symbol infos in a collection by name */
 {
-    /* Sort by symbol name */
-    return strcmp (((const SymInfo*) L)->Name,
-                   ((const SymInfo*) R)->Name);
+    /* Sort by symbol name, then id */
+    int Res = CompareNames (((const SymInfo*) L)->Name,
+                            ((const SymInfo*) R)->Name);
+    if (Res == 0) {
+        Res = (int)((const SymInfo*) L)->Id - (int)((const SymInfo*) R)->Id;
+    }
+    return Res;
 }
 
 
@@ -1888,6 +2634,54 @@ static int CompareSymInfoByVal (const void* L, const void* R)
 
 
 
+static void SortSymInfoByVal (Collection* C)
+/* Sort symbol infos in a collection by value as CompareSymInfoByVal does */
+{
+    unsigned I;
+    int      ById = 1;
+    CollKey* Keys;
+
+    for (I = 0; I < CollCount (C); ++I) {
+        const SymInfo* S = CollAt (C, I);
+        if (S->Value < -0x7FFFFFFFL - 1 || S->Value > 0x7FFFFFFFL) {
+            /* Doesn't fit into the key, use the slow path */
+            CollSort (C, CompareSymInfoByVal);
+            return;
+        }
+        if (I > 0 && ((const SymInfo*) CollAt (C, I - 1))->Id > S->Id) {
+            ById = 0;
+        }
+    }
+
+    /* The key sort is stable, so symbols with equal value and name keep
+    ** their order. Put them into id order first unless they already are, so
+    ** the ties are broken by id.
+    */
+    Keys = xmalloc (CollCount (C) * sizeof (CollKey));
+    if (!ById) {
+        for (I = 0; I < CollCount (C); ++I) {
+            SymInfo* S = CollAt (C, I);
+            Keys[I].Hi  = 0;
+            Keys[I].Lo  = S->Id;
+            Keys[I].Ptr = S;
+        }
+        CollSortByKey (C, Keys);
+    }
+
+    for (I = 0; I < CollCount (C); ++I) {
+        SymInfo* S = CollAt (C, I);
+
+        /* Flip the sign bit of the value, so negative values sort first */
+        Keys[I].Hi  = (unsigned) S->Value ^ 0x80000000U;
+        Keys[I].Lo  = PoolEntry (S->Name)->Id;
+        Keys[I].Ptr = S;
+    }
+    CollSortByKey (C, Keys);
+    xfree (Keys);
+}
+
+
+
 /*****************************************************************************/
 /*                                 Type info                                 */
 /*****************************************************************************/
@@ -1952,19 +2746,11 @@ static int CompareSymInfoByVal (const void* L, const void* R)
 
 
 
-static void FreeTypeInfo (TypeInfo* T)
-/* Free a TypeInfo struct */
-{
-    xfree (T);
-}
-
-
-
-static void InitTypeParseData (TypeParseData* P, const StrBuf* Type,
-                               unsigned ItemCount)
-/* Initialize a TypeParseData structure */
+static void InitTypeParseData (TypeParseData* P, Arena* A,
+                               const StrBuf* Type, unsigned ItemCount)
+/* Initialize a TypeParseData structure. The type info is allocated from A. */
 {
-    P->Info      = xmalloc (sizeof (*P->Info) - sizeof (P->Info->Data[0]) +
+    P->Info      = ArenaAlloc (A, sizeof (*P->Info) - sizeof (P->Info->Data[0]) +
                             ItemCount * sizeof (P->Info->Data[0]));
     P->ItemCount = ItemCount;
     P->ItemIndex = 0;
@@ -2161,12 +2947,11 @@ static TypeInfo* ParseTypeString (InputData* D, StrBuf* Type)
     }
 
     /* Initialize the data structure for parsing the type string */
-    InitTypeParseData (&P, Type, Count);
+    InitTypeParseData (&P, D->Info->Mem, Type, Count);
 
     /* Parse the type string and check for errors */
     if (TypeFromString (&P) == 0 || P.ItemCount != P.ItemIndex) {
         ParseError (D, CC65_ERROR, "Error parsing the type value");
-        FreeTypeInfo (P.Info);
         return 0;
     }
 
@@ -2191,178 +2976,89 @@ static void InitSpanInfoList (SpanInfoList* L)
 
 
 
+static cc65_addr IndexSpanInfoList (SpanInfoListEntry* List, unsigned Lo,
+                                     unsigned Hi)
+/* Set the MaxEnd fields of the subtree with the entries from Lo to Hi - 1,
+** which must not be empty, and return the highest end address in it.
+*/
+{
+    unsigned Mid = Lo + (Hi - Lo) / 2;
+    cc65_addr MaxEnd = List[Mid].End;
+    if (Lo < Mid) {
+        cc65_addr End = IndexSpanInfoList (List, Lo, Mid);
+        if (End > MaxEnd) {
+            MaxEnd = End;
+        }
+    }
+    if (Mid + 1 < Hi) {
+        cc65_addr End = IndexSpanInfoList (List, Mid + 1, Hi);
+        if (End > MaxEnd) {
+            MaxEnd = End;
+        }
+    }
+    List[Mid].MaxEnd = MaxEnd;
+    return MaxEnd;
+}
+
+
+
 static void CreateSpanInfoList (SpanInfoList* L, Collection* SpanInfos)
 /* Create a SpanInfoList from a Collection with span infos. The collection
 ** must be sorted by ascending start addresses.
 */
 {
-    unsigned I, J;
-    SpanInfo* S;
-    SpanInfoListEntry* List;
-    unsigned StartIndex;
-    cc65_addr Start;
-    cc65_addr Addr;
-    cc65_addr End;
+    unsigned I;
 
     /* Initialize and check if there's something to do */
-    L->Count = 0;
+    L->Count = CollCount (SpanInfos);
     L->List  = 0;
-    if (CollCount (SpanInfos) == 0) {
+    if (L->Count == 0) {
         /* No entries */
         return;
     }
 
-    /* Step 1: Determine the number of unique address entries needed */
-    S = CollAt (SpanInfos, 0);
-    L->Count += (S->End - S->Start) + 1;
-    End = S->End;
-    for (I = 1; I < CollCount (SpanInfos); ++I) {
+    /* Copy the spans in their order */
+    L->List = xmalloc (L->Count * sizeof (SpanInfoListEntry));
+    for (I = 0; I < L->Count; ++I) {
+        SpanInfo* S = CollAt (SpanInfos, I);
+        L->List[I].Start = S->Start;
+        L->List[I].End   = S->End;
+        L->List[I].Span  = S;
+    }
 
-        /* Get next entry */
-        S = CollAt (SpanInfos, I);
+    /* Build the tree on top of the sorted entries */
+    IndexSpanInfoList (L->List, 0, L->Count);
+}
 
-        /* Check for additional unique addresses in this span info */
-        if (S->Start > End) {
-            L->Count += (S->End - S->Start) + 1;
-            End = S->End;
-        } else if (S->End > End) {
-            L->Count += (S->End - End);
-            End = S->End;
-        }
 
-    }
 
-    /* Step 2: Allocate memory and initialize it */
-    L->List = List = xmalloc (L->Count * sizeof (*List));
-    for (I = 0; I < L->Count; ++I) {
-        List[I].Count = 0;
-        List[I].Data  = 0;
-    }
-
-    /* Step 3: Determine the number of entries per unique address */
-    List = L->List;
-    S = CollAt (SpanInfos, 0);
-    StartIndex = 0;
-    Start = S->Start;
-    End = S->End;
-    for (J = StartIndex, Addr = S->Start; Addr <= S->End; ++J, ++Addr) {
-        List[J].Addr = Addr;
-        ++List[J].Count;
-    }
-    for (I = 1; I < CollCount (SpanInfos); ++I) {
-
-        /* Get next entry */
-        S = CollAt (SpanInfos, I);
-
-        /* Determine the start index of the next range. Line infos are sorted
-        ** by ascending start address, so the start address of the next entry
-        ** is always larger than the previous one - we don't need to check
-        ** that.
-        */
-        if (S->Start <= End) {
-            /* Range starts within out already known linear range */
-            StartIndex += (unsigned) (S->Start - Start);
-            Start = S->Start;
-            if (S->End > End) {
-                End = S->End;
-            }
-        } else {
-            /* Range starts after the already known */
-            StartIndex += (unsigned) (End - Start) + 1;
-            Start = S->Start;
-            End = S->End;
-        }
-        for (J = StartIndex, Addr = S->Start; Addr <= S->End; ++J, ++Addr) {
-            List[J].Addr = Addr;
-            ++List[J].Count;
-        }
-    }
-
-    /* Step 4: Allocate memory for the indirect tables */
-    for (I = 0, List = L->List; I < L->Count; ++I, ++List) {
-
-        /* For a count of 1, we store the pointer to the lineinfo for this
-        ** address in the Data pointer directly. For counts > 1, we allocate
-        ** an array of pointers and reset the counter, so we can use it as
-        ** an index later. This is dangerous programming since it disables
-        ** all possible checks!
-        */
-        if (List->Count > 1) {
-            List->Data = xmalloc (List->Count * sizeof (SpanInfo*));
-            List->Count = 0;
-        }
-    }
-
-    /* Step 5: Enter the data into the table */
-    List = L->List;
-    S = CollAt (SpanInfos, 0);
-    StartIndex = 0;
-    Start = S->Start;
-    End = S->End;
-    for (J = StartIndex, Addr = S->Start; Addr <= S->End; ++J, ++Addr) {
-        assert (List[J].Addr == Addr);
-        if (List[J].Count == 1 && List[J].Data == 0) {
-            List[J].Data = S;
-        } else {
-            ((SpanInfo**) List[J].Data)[List[J].Count++] = S;
-        }
-    }
-    for (I = 1; I < CollCount (SpanInfos); ++I) {
-
-        /* Get next entry */
-        S = CollAt (SpanInfos, I);
-
-        /* Determine the start index of the next range. Line infos are sorted
-        ** by ascending start address, so the start address of the next entry
-        ** is always larger than the previous one - we don't need to check
-        ** that.
-        */
-        if (S->Start <= End) {
-            /* Range starts within out already known linear range */
-            StartIndex += (unsigned) (S->Start - Start);
-            Start = S->Start;
-            if (S->End > End) {
-                End = S->End;
-            }
-        } else {
-            /* Range starts after the already known */
-            StartIndex += (unsigned) (End - Start) + 1;
-            Start = S->Start;
-            End = S->End;
-        }
-        for (J = StartIndex, Addr = S->Start; Addr <= S->End; ++J, ++Addr) {
-            assert (List[J].Addr == Addr);
-            if (List[J].Count == 1 && List[J].Data == 0) {
-                List[J].Data = S;
-            } else {
-                ((SpanInfo**) List[J].Data)[List[J].Count++] = S;
-            }
-        }
-    }
+static void DoneSpanInfoList (SpanInfoList* L)
+/* Delete the contents of a span info list */
+{
+    xfree (L->List);
 }
 
 
 
-static void DoneSpanInfoList (SpanInfoList* L)
-/* Delete the contents of a span info list */
+static void InitAddrMap (AddrMap* M)
+/* Initialize an address map that is not created yet */
 {
-    unsigned I;
-
-    /* Delete the span info and the indirect data */
-    for (I = 0; I < L->Count; ++I) {
+    M->Budget = 0;
+    M->Base   = 0;
+    M->Size   = 0;
+    M->Slots  = 0;
+    M->Groups = 0;
+    M->Spans  = 0;
+}
 
-        /* Get a pointer to the entry */
-        SpanInfoListEntry* E = &L->List[I];
 
-        /* Check for indirect memory */
-        if (E->Count > 1) {
-            /* SpanInfo addressed indirectly */
-            xfree (E->Data);
-        }
-    }
 
-    /* Delete the list */
-    xfree (L->List);
+static void DoneAddrMap (AddrMap* M)
+/* Delete the contents of an address map */
+{
+    xfree (M->Slots);
+    xfree (M->Groups);
+    xfree (M->Spans);
 }
 
 
@@ -2376,6 +3072,8 @@ static void DoneSpanInfoList (SpanInfoList* L)
 static DbgInfo* NewDbgInfo (const char* FileName)
 /* Create a new DbgInfo struct and return it */
 {
+    unsigned I;
+
     /* Get the length of the name */
     unsigned Len = strlen (FileName);
 
@@ -2399,11 +3097,30 @@ static DbgInfo* NewDbgInfo (const char* FileName)
     CollInit (&Info->ModInfoByName);
     CollInit (&Info->ScopeInfoByName);
     CollInit (&Info->SegInfoByName);
+    CollInit (&Info->SegInfoByAddr);
     CollInit (&Info->SymInfoByName);
     CollInit (&Info->SymInfoByVal);
+    CollInit (&Info->LabelInfoByVal);
+
+    InitNameIndex (&Info->CSymFuncIndex);
+    InitNameIndex (&Info->ScopeIndex);
+    InitNameIndex (&Info->SegIndex);
+    InitNameIndex (&Info->SymIndex);
+
+    for (I = 0; I < INDEX_COUNT; ++I) {
+        CollInit (&Info->Sorts[I]);
+    }
+    Info->Built = 0;
+#if HAVE_THREADS
+    pthread_mutex_init (&Info->Lock, 0);
+#endif
 
+    CollInit (&Info->SpanInfoByStart);
     InitSpanInfoList (&Info->SpanInfoByAddr);
+    InitAddrMap (&Info->SpanMap);
 
+    Info->Mem          = NewArena ();
+    InitStrPool (&Info->Names);
     Info->MemUsage     = 0;
     Info->MajorVersion = 0;
     Info->MinorVersion = 0;
@@ -2418,39 +3135,7 @@ static DbgInfo* NewDbgInfo (const char* FileName)
 static void FreeDbgInfo (DbgInfo* Info)
 /* Free a DbgInfo struct */
 {
-    unsigned I;
-
-    /* First, free the items in the collections */
-    for (I = 0; I < CollCount (&Info->CSymInfoById); ++I) {
-        FreeCSymInfo (CollAt (&Info->CSymInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->FileInfoById); ++I) {
-        FreeFileInfo (CollAt (&Info->FileInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->LibInfoById); ++I) {
-        FreeLibInfo (CollAt (&Info->LibInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->LineInfoById); ++I) {
-        FreeLineInfo (CollAt (&Info->LineInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->ModInfoById); ++I) {
-        FreeModInfo (CollAt (&Info->ModInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->ScopeInfoById); ++I) {
-        FreeScopeInfo (CollAt (&Info->ScopeInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->SegInfoById); ++I) {
-        FreeSegInfo (CollAt (&Info->SegInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->SpanInfoById); ++I) {
-        FreeSpanInfo (CollAt (&Info->SpanInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->SymInfoById); ++I) {
-        FreeSymInfo (CollAt (&Info->SymInfoById, I));
-    }
-    for (I = 0; I < CollCount (&Info->TypeInfoById); ++I) {
-        FreeTypeInfo (CollAt (&Info->TypeInfoById, I));
-    }
+    unsigned I, J;
 
     /* Free the memory used by the id collections */
     CollDone (&Info->CSymInfoById);
@@ -2470,11 +3155,36 @@ static void FreeDbgInfo (DbgInfo* Info)
     CollDone (&Info->ModInfoByName);
     CollDone (&Info->ScopeInfoByName);
     CollDone (&Info->SegInfoByName);
+    CollDone (&Info->SegInfoByAddr);
     CollDone (&Info->SymInfoByName);
     CollDone (&Info->SymInfoByVal);
+    CollDone (&Info->LabelInfoByVal);
+
+    /* Free the name indexes */
+    DoneNameIndex (&Info->CSymFuncIndex);
+    DoneNameIndex (&Info->ScopeIndex);
+    DoneNameIndex (&Info->SegIndex);
+    DoneNameIndex (&Info->SymIndex);
+
+    /* Free the sorts for indexes that were never built */
+    for (I = 0; I < INDEX_COUNT; ++I) {
+        for (J = 0; J < CollCount (&Info->Sorts[I]); ++J) {
+            xfree (CollAt (&Info->Sorts[I], J));
+        }
+        CollDone (&Info->Sorts[I]);
+    }
+#if HAVE_THREADS
+    pthread_mutex_destroy (&Info->Lock);
+#endif
 
     /* Free span info */
+    CollDone (&Info->SpanInfoByStart);
     DoneSpanInfoList (&Info->SpanInfoByAddr);
+    DoneAddrMap (&Info->SpanMap);
+
+    /* Free the name pool and all items */
+    DoneStrPool (&Info->Names);
+    FreeArena (Info->Mem);
 
     /* Free the structure itself */
     xfree (Info);
@@ -2482,6 +3192,111 @@ static void FreeDbgInfo (DbgInfo* Info)
 
 
 
+static void MergeById (Collection* Target, Collection* Source)
+/* Move the items from Source to the same index in Target, replacing items
+** that are already there. Source is emptied.
+*/
+{
+    unsigned I;
+    for (I = 0; I < CollCount (Source); ++I) {
+        void* Item = CollAt (Source, I);
+        if (Item) {
+            CollReplaceExpand (Target, Item, I);
+        }
+    }
+    CollDone (Source);
+}
+
+
+
+static void MergeAppend (Collection* Target, Collection* Source)
+/* Append the items from Source to Target. Source is emptied. */
+{
+    unsigned I;
+    CollGrow (Target, CollCount (Target) + CollCount (Source));
+    for (I = 0; I < CollCount (Source); ++I) {
+        CollAppend (Target, CollAt (Source, I));
+    }
+    CollDone (Source);
+}
+
+
+
+static void MergeNames (StrPool* Target, Collection* Items, size_t NameOffs)
+/* Move the names of all items in a collection into the Target pool. NameOffs
+** is the offset of the name pointer in the items, which may be NULL.
+*/
+{
+    unsigned I;
+    for (I = 0; I < CollCount (Items); ++I) {
+        char* Item = CollAt (Items, I);
+        if (Item) {
+            const char** Name = (const char**) (Item + NameOffs);
+            if (*Name) {
+                *Name = SP_Adopt (Target, *Name);
+            }
+        }
+    }
+}
+
+
+
+static void MergeDbgInfo (DbgInfo* Target, DbgInfo* Source)
+/* Move all items parsed into Source over to Target and free Source. Source
+** must contain items from input that follows the input parsed into Target.
+** Must be called before postprocessing.
+*/
+{
+    unsigned I, J;
+
+    /* Use the names from Target, so equal names are identical again */
+    MergeNames (&Target->Names, &Source->CSymInfoById, offsetof (CSymInfo, Name));
+    MergeNames (&Target->Names, &Source->FileInfoById, offsetof (FileInfo, Name));
+    MergeNames (&Target->Names, &Source->LibInfoById, offsetof (LibInfo, Name));
+    MergeNames (&Target->Names, &Source->ModInfoById, offsetof (ModInfo, Name));
+    MergeNames (&Target->Names, &Source->ScopeInfoById, offsetof (ScopeInfo, Name));
+    MergeNames (&Target->Names, &Source->SegInfoById, offsetof (SegInfo, Name));
+    MergeNames (&Target->Names, &Source->SymInfoById, offsetof (SymInfo, Name));
+    MergeNames (&Target->Names, &Source->SegInfoById, offsetof (SegInfo, OutputName));
+    DoneStrPool (&Source->Names);
+
+    MergeById (&Target->CSymInfoById, &Source->CSymInfoById);
+    MergeById (&Target->FileInfoById, &Source->FileInfoById);
+    MergeById (&Target->LibInfoById, &Source->LibInfoById);
+    MergeById (&Target->LineInfoById, &Source->LineInfoById);
+    MergeById (&Target->ModInfoById, &Source->ModInfoById);
+    MergeById (&Target->ScopeInfoById, &Source->ScopeInfoById);
+    MergeById (&Target->SegInfoById, &Source->SegInfoById);
+    MergeById (&Target->SpanInfoById, &Source->SpanInfoById);
+    MergeById (&Target->SymInfoById, &Source->SymInfoById);
+    MergeById (&Target->TypeInfoById, &Source->TypeInfoById);
+
+    MergeAppend (&Target->CSymFuncByName, &Source->CSymFuncByName);
+    MergeAppend (&Target->FileInfoByName, &Source->FileInfoByName);
+    MergeAppend (&Target->ModInfoByName, &Source->ModInfoByName);
+    MergeAppend (&Target->ScopeInfoByName, &Source->ScopeInfoByName);
+    MergeAppend (&Target->SegInfoByName, &Source->SegInfoByName);
+    MergeAppend (&Target->SegInfoByAddr, &Source->SegInfoByAddr);
+    MergeAppend (&Target->SymInfoByName, &Source->SymInfoByName);
+    MergeAppend (&Target->SymInfoByVal, &Source->SymInfoByVal);
+
+    CollDone (&Source->SpanInfoByStart);
+    DoneSpanInfoList (&Source->SpanInfoByAddr);
+    for (I = 0; I < INDEX_COUNT; ++I) {
+        for (J = 0; J < CollCount (&Source->Sorts[I]); ++J) {
+            xfree (CollAt (&Source->Sorts[I], J));
+        }
+        CollDone (&Source->Sorts[I]);
+    }
+#if HAVE_THREADS
+    pthread_mutex_destroy (&Source->Lock);
+#endif
+    ArenaMerge (Target->Mem, Source->Mem);
+    xfree (Source);
+}
+
+
+
 /*****************************************************************************/
 /*                            Scanner and parser                             */
 /*****************************************************************************/
@@ -2502,26 +3317,232 @@ static int DigitVal (int C)
 
 
 
+static int ReadLine (InputData* D)
+/* Read the next line from a stdio input into the line buffer and make it
+** the current input buffer. Return false if there is no more input.
+*/
+{
+    int C;
+
+    if (D->F == 0) {
+        return 0;
+    }
+    SB_Clear (&D->LineBuf);
+    while ((C = getc (D->F)) != EOF) {
+        SB_AppendChar (&D->LineBuf, C);
+        if (C == '\n') {
+            break;
+        }
+    }
+    if (SB_GetLen (&D->LineBuf) == 0) {
+        return 0;
+    }
+    D->Buf   = D->Pos = D->LineStart = SB_GetConstBuf (&D->LineBuf);
+    D->End   = D->Buf + SB_GetLen (&D->LineBuf);
+    D->Block = 0;
+    return 1;
+}
+
+
+
 static void NextChar (InputData* D)
-/* Read the next character from the input. Count lines and columns */
+/* Read the next character from the input */
 {
     /* Check if we've encountered EOF before */
     if (D->C >= 0) {
-        if (D->C == '\n') {
-            ++D->Line;
-            D->Col = 0;
+        if (D->Pos < D->End || ReadLine (D)) {
+            D->C = (unsigned char) *D->Pos++;
+        } else {
+            D->C = EOF;
         }
-        D->C = fgetc (D->F);
-        ++D->Col;
     }
 }
 
 
 
-static void NextToken (InputData* D)
-/* Read the next token from the input stream */
+static void SetPos (InputData* D, const char* P)
+/* Make the character at P the current input character. P must not skip a
+** newline.
+*/
+{
+    if (P < D->End) {
+        D->C   = (unsigned char) *P;
+        D->Pos = P + 1;
+    } else {
+        D->C   = EOF;
+        D->Pos = D->End;
+    }
+}
+
+
+
+/* The buffered scanner doesn't look at identifiers and strings one character
+** at a time. Instead, the input is classified in blocks of 64 bytes, and
+** for each block, two bitmasks are built: One with a bit set for each byte
+** that cannot be part of an identifier (whitespace, ',', '=', '"', '\n' and
+** everything else), and one with bits set for the characters that end a
+** string constant ('"' and '\n'). The end of a token is then just the next
+** set bit in one of the masks. Bytes beyond the end of the input are
+** marked in both masks.
+*/
+#define IsIdentChar(C)  ((C) == '_' ||                                  \
+                         ((C) >= '0' && (C) <= '9') ||                  \
+                         (((C) | 0x20) >= 'a' && ((C) | 0x20) <= 'z'))
+
+
+
+static void ClassifyScalar (const char* P, unsigned Count,
+                            uint64_t* DelimMask, uint64_t* QuoteMask)
+/* Classify Count bytes (at most 64) at P */
+{
+    uint64_t D = 0;
+    uint64_t Q = 0;
+    unsigned I;
+    for (I = 0; I < Count; ++I) {
+        unsigned char C = P[I];
+        if (!IsIdentChar (C)) {
+            D |= (uint64_t) 1 << I;
+        }
+        if (C == '\"' || C == '\n') {
+            Q |= (uint64_t) 1 << I;
+        }
+    }
+    if (Count < 64) {
+        D |= ~(uint64_t) 0 << Count;
+        Q |= ~(uint64_t) 0 << Count;
+    }
+    *DelimMask = D;
+    *QuoteMask = Q;
+}
+
+
+
+#if HAVE_SSE2
+
+static void ClassifySSE2 (const char* P, uint64_t* DelimMask, uint64_t* QuoteMask)
+/* Classify 64 bytes at P, 16 bytes per step */
+{
+    uint64_t D = 0;
+    uint64_t Q = 0;
+    unsigned I;
+    for (I = 0; I < 64; I += 16) {
+        __m128i X = _mm_loadu_si128 ((const __m128i*) (P + I));
+        __m128i L = _mm_or_si128 (X, _mm_set1_epi8 (0x20));
+        __m128i Id = _mm_or_si128 (
+            _mm_or_si128 (
+                _mm_and_si128 (_mm_cmpgt_epi8 (L, _mm_set1_epi8 ('a' - 1)),
+                               _mm_cmplt_epi8 (L, _mm_set1_epi8 ('z' + 1))),
+                _mm_and_si128 (_mm_cmpgt_epi8 (X, _mm_set1_epi8 ('0' - 1)),
+                               _mm_cmplt_epi8 (X, _mm_set1_epi8 ('9' + 1)))),
+            _mm_cmpeq_epi8 (X, _mm_set1_epi8 ('_')));
+        __m128i Qt = _mm_or_si128 (_mm_cmpeq_epi8 (X, _mm_set1_epi8 ('\"')),
+                                   _mm_cmpeq_epi8 (X, _mm_set1_epi8 ('\n')));
+        D |= (uint64_t) (~_mm_movemask_epi8 (Id) & 0xFFFF) << I;
+        Q |= (uint64_t) _mm_movemask_epi8 (Qt) << I;
+    }
+    *DelimMask = D;
+    *QuoteMask = Q;
+}
+
+
+
+__attribute__ ((target ("avx2")))
+static void ClassifyAVX2 (const char* P, uint64_t* DelimMask, uint64_t* QuoteMask)
+/* Classify 64 bytes at P, 32 bytes per step */
+{
+    uint64_t D = 0;
+    uint64_t Q = 0;
+    unsigned I;
+    for (I = 0; I < 64; I += 32) {
+        __m256i X = _mm256_loadu_si256 ((const __m256i*) (P + I));
+        __m256i L = _mm256_or_si256 (X, _mm256_set1_epi8 (0x20));
+        __m256i Id = _mm256_or_si256 (
+            _mm256_or_si256 (
+                _mm256_and_si256 (_mm256_cmpgt_epi8 (L, _mm256_set1_epi8 ('a' - 1)),
+                                  _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('z' + 1), L)),
+                _mm256_and_si256 (_mm256_cmpgt_epi8 (X, _mm256_set1_epi8 ('0' - 1)),
+                                  _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('9' + 1), X))),
+            _mm256_cmpeq_epi8 (X, _mm256_set1_epi8 ('_')));
+        __m256i Qt = _mm256_or_si256 (_mm256_cmpeq_epi8 (X, _mm256_set1_epi8 ('\"')),
+                                      _mm256_cmpeq_epi8 (X, _mm256_set1_epi8 ('\n')));
+        D |= (uint64_t) (uint32_t) ~_mm256_movemask_epi8 (Id) << I;
+        Q |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (Qt) << I;
+    }
+    *DelimMask = D;
+    *QuoteMask = Q;
+}
+
+#endif
+
+
+
+static void ClassifyBlock (InputData* D, const char* P)
+/* Classify the 64 byte block of the input buffer that contains P */
+{
+    D->Block = D->Buf + ((P - D->Buf) & ~(size_t) 63);
+    if (D->End - D->Block < 64) {
+        ClassifyScalar (D->Block, D->End - D->Block, &D->DelimMask, &D->QuoteMask);
+#if HAVE_SSE2
+    } else if (__builtin_cpu_supports ("avx2")) {
+        ClassifyAVX2 (D->Block, &D->DelimMask, &D->QuoteMask);
+    } else {
+        ClassifySSE2 (D->Block, &D->DelimMask, &D->QuoteMask);
+#else
+    } else {
+        ClassifyScalar (D->Block, 64, &D->DelimMask, &D->QuoteMask);
+#endif
+    }
+}
+
+
+
+static unsigned LowestBit (uint64_t Mask)
+/* Return the index of the lowest bit set in Mask, which must not be zero */
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll (Mask);
+#else
+    unsigned I = 0;
+    while ((Mask & 0x01) == 0) {
+        Mask >>= 1;
+        ++I;
+    }
+    return I;
+#endif
+}
+
+
+
+static const char* ScanFor (InputData* D, const char* P, int Quotes)
+/* Return a pointer to the first character at or after P that ends an
+** identifier, or a string constant if Quotes is true. Returns D->End if
+** there is no such character.
+*/
+{
+    while (P < D->End) {
+        uint64_t Mask;
+        if (D->Block == 0 || P < D->Block || P - D->Block >= 64) {
+            ClassifyBlock (D, P);
+        }
+        Mask = (Quotes? D->QuoteMask : D->DelimMask) >> (P - D->Block);
+        if (Mask) {
+            P += LowestBit (Mask);
+            return (P < D->End)? P : D->End;
+        }
+        P = D->Block + 64;
+    }
+    return D->End;
+}
+
+
+
+static Token FindKeyword (const char* Id, unsigned Len)
+/* Return the keyword token for the identifier Id with length Len, or
+** TOK_IDENT if Id is not a keyword. Id need not be terminated.
+*/
 {
-    static const struct KeywordEntry  {
+    /* List of keywords */
+    static const struct KeywordEntry {
         const char      Keyword[12];
         Token           Tok;
     } KeywordTable[] = {
@@ -2574,40 +3595,69 @@ static void NextToken (InputData* D)
         { "zp",         TOK_ZEROPAGE    },
     };
 
+    /* Perfect hash over the keywords above. The hash function uses the
+    ** length, and the first, second and last character (length and first and
+    ** last alone don't separate "lab"/"lib" and "major"/"minor"). The
+    ** multipliers were found by a brute force search and must be searched
+    ** again and the table regenerated if keywords are added. Entries are
+    ** indices into KeywordTable plus one, zero means no keyword.
+    */
+    static const unsigned char KeywordHash[128] = {
+        31,  0,  0,  0,  0,  0,  0,  0, 23,  0,  0,  0,  3, 36, 26, 24,
+         0, 17,  0, 46,  9, 44,  0,  0,  0, 27,  0,  0,  0,  0,  0,  0,
+        39, 41,  0, 20,  0,  0,  0,  0, 34,  0,  0, 11,  0,  8,  0,  0,
+        22, 12, 29,  0,  0,  0,  0,  0,  0,  0,  0, 42,  0,  6,  0,  0,
+        15,  0,  0,  0, 40, 35,  0,  0, 10,  0,  0, 14, 16,  0,  0,  0,
+         0, 18,  0, 25, 37,  0,  0, 32,  4,  0,  0,  0,  5, 13,  0,  0,
+         0, 43,  0, 45, 47,  0,  0, 28,  0,  0,  0,  0,  0,  0,  0,  0,
+        21, 38,  0, 30,  0,  0,  2,  1,  0, 19,  0,  0,  0,  0,  7, 33,
+    };
+
+    const struct KeywordEntry* Entry;
+    unsigned Index;
+
+    if (Len < 2 || Len >= sizeof (KeywordTable[0].Keyword)) {
+        return TOK_IDENT;
+    }
+    Index = KeywordHash[(13 * ((unsigned char) Id[0] + (unsigned char) Id[Len-1]) +
+                         24 * (unsigned char) Id[1] + Len) & 0x7F];
+    if (Index == 0) {
+        return TOK_IDENT;
+    }
+    Entry = KeywordTable + Index - 1;
+    if (Entry->Keyword[Len] != '\0' || memcmp (Entry->Keyword, Id, Len) != 0) {
+        return TOK_IDENT;
+    }
+    return Entry->Tok;
+}
+
 
+
+static void NextToken (InputData* D)
+/* Read the next token from the input stream */
+{
     /* Skip whitespace */
     while (D->C == ' ' || D->C == '\t' || D->C == '\r') {
         NextChar (D);
     }
 
-    /* Remember the current position as start of the next token */
+    /* Remember the current position as start of the next token. EOF counts
+    ** as a character.
+    */
     D->SLine = D->Line;
-    D->SCol  = D->Col;
+    D->SCol  = (unsigned) (D->Pos - D->LineStart) + (D->C == EOF);
 
     /* Identifier? */
     if (D->C == '_' || isalpha (D->C)) {
 
-        const struct KeywordEntry* Entry;
-
-        /* Read the identifier */
-        SB_Clear (&D->SVal);
-        while (D->C == '_' || isalnum (D->C)) {
-            SB_AppendChar (&D->SVal, D->C);
-            NextChar (D);
-        }
-        SB_Terminate (&D->SVal);
+        /* The identifier is classified in place and not copied */
+        const char* P = ScanFor (D, D->Pos, 0);
+        D->SVal.Ptr = D->Pos - 1;
+        D->SVal.Len = P - D->SVal.Ptr;
+        SetPos (D, P);
 
-        /* Search the identifier in the keyword table */
-        Entry = bsearch (SB_GetConstBuf (&D->SVal),
-                         KeywordTable,
-                         sizeof (KeywordTable) / sizeof (KeywordTable[0]),
-                         sizeof (KeywordTable[0]),
-                         (int (*)(const void*, const void*)) strcmp);
-        if (Entry == 0) {
-            D->Tok = TOK_IDENT;
-        } else {
-            D->Tok = Entry->Tok;
-        }
+        /* Check for a keyword */
+        D->Tok = FindKeyword (D->SVal.Ptr, D->SVal.Len);
         return;
     }
 
@@ -2659,26 +3709,29 @@ static void NextToken (InputData* D)
             break;
 
         case '\"':
-            SB_Clear (&D->SVal);
-            NextChar (D);
-            while (1) {
-                if (D->C == '\n' || D->C == EOF) {
-                    ParseError (D, CC65_ERROR, "Unterminated string constant");
-                    break;
-                }
+            {
+                /* The string references the input and is not copied */
+                const char* P = ScanFor (D, D->Pos, 1);
+                D->SVal.Ptr = D->Pos;
+                D->SVal.Len = P - D->Pos;
+                SetPos (D, P);
                 if (D->C == '\"') {
                     NextChar (D);
-                    break;
+                } else {
+                    ParseError (D, CC65_ERROR, "Unterminated string constant");
                 }
-                SB_AppendChar (&D->SVal, D->C);
-                NextChar (D);
             }
-            SB_Terminate (&D->SVal);
             D->Tok = TOK_STRCON;
             break;
 
         case '\n':
-            NextChar (D);
+            /* Don't read beyond the end of the line. Tokens reference the
+            ** input buffer, and with stdio input, reading ahead would replace
+            ** the line before the record has been built from it.
+            */
+            ++D->Line;
+            D->LineStart = D->Pos;
+            D->C   = ' ';
             D->Tok = TOK_EOL;
             break;
 
@@ -2702,6 +3755,28 @@ static int TokenIsKeyword (Token Tok)
 
 
 
+static unsigned RecordKind (Token Tok)
+/* Return the record kind for a keyword that starts a record line, or zero
+** if Tok doesn't start a record.
+*/
+{
+    switch (Tok) {
+        case TOK_CSYM:          return CC65_RECORD_CSYM;
+        case TOK_FILE:          return CC65_RECORD_FILE;
+        case TOK_LIBRARY:       return CC65_RECORD_LIB;
+        case TOK_LINE:          return CC65_RECORD_LINE;
+        case TOK_MODULE:        return CC65_RECORD_MOD;
+        case TOK_SCOPE:         return CC65_RECORD_SCOPE;
+        case TOK_SEGMENT:       return CC65_RECORD_SEG;
+        case TOK_SPAN:          return CC65_RECORD_SPAN;
+        case TOK_SYM:           return CC65_RECORD_SYM;
+        case TOK_TYPE:          return CC65_RECORD_TYPE;
+        default:                return 0;
+    }
+}
+
+
+
 static int TokenFollows (InputData* D, Token Tok, const char* Name)
 /* Check for a specific token that follows. */
 {
@@ -2755,6 +3830,29 @@ static int ConsumeEqual (InputData* D)
 
 
 
+static void SkipRecord (InputData* D)
+/* Skip the rest of a record line that is not wanted. Other than SkipLine,
+** this doesn't scan the line but just searches for the newline.
+*/
+{
+    if (D->C != '\n' && D->C != EOF) {
+        const char* NL;
+        while ((NL = memchr (D->Pos, '\n', D->End - D->Pos)) == 0) {
+            D->Pos = D->End;
+            if (!ReadLine (D)) {
+                D->C = EOF;
+                NextToken (D);
+                return;
+            }
+        }
+        D->Pos = NL + 1;
+        D->C   = '\n';
+    }
+    NextToken (D);
+}
+
+
+
 static void ConsumeEOL (InputData* D)
 /* Consume an end-of-line token, if we aren't at end-of-file */
 {
@@ -2769,6 +3867,16 @@ static void ConsumeEOL (InputData* D)
 
 
 
+static const char* InternName (InputData* D, const StrRef* Name)
+/* Add a name to the string pool of the debug info and return the pooled
+** copy.
+*/
+{
+    return SP_Add (&D->Info->Names, D->Info->Mem, Name->Ptr, Name->Len);
+}
+
+
+
 static void ParseCSym (InputData* D)
 /* Parse a CSYM line */
 {
@@ -2776,7 +3884,7 @@ static void ParseCSym (InputData* D)
     ** overwritten later. This is just to avoid compiler warnings.
     */
     unsigned            Id = 0;
-    StrBuf              Name = STRBUF_INITIALIZER;
+    StrRef              Name = STRREF_INITIALIZER;
     int                 Offs = 0;
     cc65_csym_sc        SC = CC65_CSYM_AUTO;
     unsigned            ScopeId = 0;
@@ -2844,8 +3952,7 @@ static void ParseCSym (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&Name, &D->SVal);
-                SB_Terminate (&Name);
+                Name = D->SVal;
                 InfoBits |= ibName;
                 NextToken (D);
                 break;
@@ -2939,7 +4046,7 @@ static void ParseCSym (InputData* D)
     }
 
     /* Create the symbol info */
-    S = NewCSymInfo (&Name);
+    S = NewCSymInfo (D->Info->Mem, InternName (D, &Name));
     S->Id         = Id;
     S->Kind       = CC65_CSYM_VAR;
     S->SC         = SC;
@@ -2953,7 +4060,6 @@ static void ParseCSym (InputData* D)
 
 ErrorExit:
     /* Entry point in case of errors */
-    SB_Done (&Name);
     return;
 }
 
@@ -2966,7 +4072,7 @@ static void ParseFile (InputData* D)
     unsigned long Size = 0;
     unsigned long MTime = 0;
     Collection    ModIds = COLLECTION_INITIALIZER;
-    StrBuf        Name = STRBUF_INITIALIZER;
+    StrRef        Name = STRREF_INITIALIZER;
     FileInfo*     F;
     enum {
         ibNone      = 0x00,
@@ -3048,8 +4154,7 @@ static void ParseFile (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&Name, &D->SVal);
-                SB_Terminate (&Name);
+                Name = D->SVal;
                 InfoBits |= ibName;
                 NextToken (D);
                 break;
@@ -3091,18 +4196,17 @@ static void ParseFile (InputData* D)
     }
 
     /* Create the file info and remember it */
-    F = NewFileInfo (&Name);
+    F = NewFileInfo (D->Info->Mem, InternName (D, &Name));
     F->Id       = Id;
     F->Size     = Size;
     F->MTime    = MTime;
-    CollMove (&ModIds, &F->ModInfoByName);
+    CollCopy (&F->ModInfoByName, &ModIds);
     CollReplaceExpand (&D->Info->FileInfoById, F, Id);
     CollAppend (&D->Info->FileInfoByName, F);
 
 ErrorExit:
     /* Entry point in case of errors */
     CollDone (&ModIds);
-    SB_Done (&Name);
     return;
 }
 
@@ -3148,52 +4252,56 @@ static void ParseInfo (InputData* D)
             goto ErrorExit;
         }
 
-        /* Check what the token was */
-        switch (Tok) {
+        /* Check what the token was. Nothing to do for kinds not loaded. */
+        switch (RecordKind (Tok) & D->Records) {
 
-            case TOK_CSYM:
+            case 0:
+                break;
+
+            case CC65_RECORD_CSYM:
                 CollGrow (&D->Info->CSymInfoById,  D->IVal);
                 break;
 
-            case TOK_FILE:
+            case CC65_RECORD_FILE:
                 CollGrow (&D->Info->FileInfoById,   D->IVal);
                 CollGrow (&D->Info->FileInfoByName, D->IVal);
                 break;
 
-            case TOK_LIBRARY:
+            case CC65_RECORD_LIB:
                 CollGrow (&D->Info->LibInfoById, D->IVal);
                 break;
 
-            case TOK_LINE:
+            case CC65_RECORD_LINE:
                 CollGrow (&D->Info->LineInfoById, D->IVal);
                 break;
 
-            case TOK_MODULE:
+            case CC65_RECORD_MOD:
                 CollGrow (&D->Info->ModInfoById,   D->IVal);
                 CollGrow (&D->Info->ModInfoByName, D->IVal);
                 break;
 
-            case TOK_SCOPE:
+            case CC65_RECORD_SCOPE:
                 CollGrow (&D->Info->ScopeInfoById, D->IVal);
                 CollGrow (&D->Info->ScopeInfoByName, D->IVal);
                 break;
 
-            case TOK_SEGMENT:
+            case CC65_RECORD_SEG:
                 CollGrow (&D->Info->SegInfoById,   D->IVal);
                 CollGrow (&D->Info->SegInfoByName, D->IVal);
+                CollGrow (&D->Info->SegInfoByAddr, D->IVal);
                 break;
 
-            case TOK_SPAN:
+            case CC65_RECORD_SPAN:
                 CollGrow (&D->Info->SpanInfoById,  D->IVal);
                 break;
 
-            case TOK_SYM:
+            case CC65_RECORD_SYM:
                 CollGrow (&D->Info->SymInfoById,   D->IVal);
                 CollGrow (&D->Info->SymInfoByName, D->IVal);
                 CollGrow (&D->Info->SymInfoByVal,  D->IVal);
                 break;
 
-            case TOK_TYPE:
+            case CC65_RECORD_TYPE:
                 CollGrow (&D->Info->TypeInfoById,  D->IVal);
                 break;
 
@@ -3232,7 +4340,7 @@ static void ParseLibrary (InputData* D)
 /* Parse a LIBRARY line */
 {
     unsigned      Id = 0;
-    StrBuf        Name = STRBUF_INITIALIZER;
+    StrRef        Name = STRREF_INITIALIZER;
     LibInfo*      L;
     enum {
         ibNone      = 0x00,
@@ -3285,8 +4393,7 @@ static void ParseLibrary (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&Name, &D->SVal);
-                SB_Terminate (&Name);
+                Name = D->SVal;
                 InfoBits |= ibName;
                 NextToken (D);
                 break;
@@ -3319,13 +4426,12 @@ static void ParseLibrary (InputData* D)
     }
 
     /* Create the library info and remember it */
-    L = NewLibInfo (&Name);
+    L = NewLibInfo (D->Info->Mem, InternName (D, &Name));
     L->Id = Id;
     CollReplaceExpand (&D->Info->LibInfoById, L, Id);
 
 ErrorExit:
     /* Entry point in case of errors */
-    SB_Done (&Name);
     return;
 }
 
@@ -3475,13 +4581,13 @@ static void ParseLine (InputData* D)
     }
 
     /* Create the line info and remember it */
-    L = NewLineInfo ();
+    L = NewLineInfo (D->Info->Mem);
     L->Id       = Id;
     L->Line     = Line;
     L->File.Id  = FileId;
     L->Type     = Type;
     L->Count    = Count;
-    CollMove (&SpanIds, &L->SpanInfoList);
+    CollCopy (&L->SpanInfoList, &SpanIds);
     CollReplaceExpand (&D->Info->LineInfoById, L, Id);
 
 ErrorExit:
@@ -3499,7 +4605,7 @@ static void ParseModule (InputData* D)
     ** overwritten later. This is just to avoid compiler warnings.
     */
     unsigned            Id = CC65_INV_ID;
-    StrBuf              Name = STRBUF_INITIALIZER;
+    StrRef              Name = STRREF_INITIALIZER;
     unsigned            FileId = CC65_INV_ID;
     unsigned            LibId = CC65_INV_ID;
     ModInfo*            M;
@@ -3568,8 +4674,7 @@ static void ParseModule (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&Name, &D->SVal);
-                SB_Terminate (&Name);
+                Name = D->SVal;
                 InfoBits |= ibName;
                 NextToken (D);
                 break;
@@ -3611,7 +4716,7 @@ static void ParseModule (InputData* D)
     }
 
     /* Create the scope info */
-    M = NewModInfo (&Name);
+    M = NewModInfo (D->Info->Mem, InternName (D, &Name));
     M->File.Id = FileId;
     M->Id      = Id;
     M->Lib.Id  = LibId;
@@ -3622,7 +4727,6 @@ static void ParseModule (InputData* D)
 
 ErrorExit:
     /* Entry point in case of errors */
-    SB_Done (&Name);
     return;
 }
 
@@ -3637,7 +4741,7 @@ static void ParseScope (InputData* D)
     unsigned            Id = CC65_INV_ID;
     cc65_scope_type     Type = CC65_SCOPE_MODULE;
     cc65_size           Size = 0;
-    StrBuf              Name = STRBUF_INITIALIZER;
+    StrRef              Name = STRREF_INITIALIZER;
     unsigned            ModId = CC65_INV_ID;
     unsigned            ParentId = CC65_INV_ID;
     Collection          SpanIds = COLLECTION_INITIALIZER;
@@ -3714,8 +4818,7 @@ static void ParseScope (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&Name, &D->SVal);
-                SB_Terminate (&Name);
+                Name = D->SVal;
                 InfoBits |= ibName;
                 NextToken (D);
                 break;
@@ -3807,14 +4910,14 @@ static void ParseScope (InputData* D)
     }
 
     /* Create the scope info ... */
-    S = NewScopeInfo (&Name);
+    S = NewScopeInfo (D->Info->Mem, InternName (D, &Name));
     S->Id        = Id;
     S->Type      = Type;
     S->Size      = Size;
     S->Mod.Id    = ModId;
     S->Parent.Id = ParentId;
     S->Label.Id  = SymId;
-    CollMove (&SpanIds, &S->SpanInfoList);
+    CollCopy (&S->SpanInfoList, &SpanIds);
 
     /* ... and remember it */
     CollReplaceExpand (&D->Info->ScopeInfoById, S, Id);
@@ -3823,7 +4926,6 @@ static void ParseScope (InputData* D)
 ErrorExit:
     /* Entry point in case of errors */
     CollDone (&SpanIds);
-    SB_Done (&Name);
     return;
 }
 
@@ -3835,8 +4937,8 @@ static void ParseSegment (InputData* D)
     unsigned        Id = 0;
     cc65_addr       Start = 0;
     cc65_addr       Size = 0;
-    StrBuf          Name = STRBUF_INITIALIZER;
-    StrBuf          OutputName = STRBUF_INITIALIZER;
+    StrRef          Name = STRREF_INITIALIZER;
+    StrRef          OutputName = STRREF_INITIALIZER;
     unsigned long   OutputOffs = 0;
     SegInfo*        S;
     enum {
@@ -3905,8 +5007,7 @@ static void ParseSegment (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&Name, &D->SVal);
-                SB_Terminate (&Name);
+                Name = D->SVal;
                 InfoBits |= ibName;
                 NextToken (D);
                 break;
@@ -3915,8 +5016,7 @@ static void ParseSegment (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&OutputName, &D->SVal);
-                SB_Terminate (&OutputName);
+                OutputName = D->SVal;
                 InfoBits |= ibOutputName;
                 NextToken (D);
                 break;
@@ -3992,14 +5092,15 @@ static void ParseSegment (InputData* D)
     }
 
     /* Create the segment info and remember it */
-    S = NewSegInfo (&Name, Id, Start, Size, &OutputName, OutputOffs);
+    S = NewSegInfo (D->Info->Mem, InternName (D, &Name), Id, Start, Size,
+                    OutputName.Len > 0? InternName (D, &OutputName) : 0,
+                    OutputOffs);
     CollReplaceExpand (&D->Info->SegInfoById, S, Id);
     CollAppend (&D->Info->SegInfoByName, S);
+    CollAppend (&D->Info->SegInfoByAddr, S);
 
 ErrorExit:
     /* Entry point in case of errors */
-    SB_Done (&Name);
-    SB_Done (&OutputName);
     return;
 }
 
@@ -4131,7 +5232,7 @@ static void ParseSpan (InputData* D)
     }
 
     /* Create the span info and remember it */
-    S = NewSpanInfo ();
+    S = NewSpanInfo (D->Info->Mem);
     S->Id       = Id;
     S->Start    = Start;
     S->End      = Start + Size - 1;
@@ -4156,7 +5257,7 @@ static void ParseSym (InputData* D)
     unsigned            ExportId = CC65_INV_ID;
     unsigned            FileId = CC65_INV_ID;
     unsigned            Id = CC65_INV_ID;
-    StrBuf              Name = STRBUF_INITIALIZER;
+    StrRef              Name = STRREF_INITIALIZER;
     unsigned            ParentId = CC65_INV_ID;
     Collection          RefLineIds = COLLECTION_INITIALIZER;
     unsigned            ScopeId = CC65_INV_ID;
@@ -4274,8 +5375,7 @@ static void ParseSym (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&Name, &D->SVal);
-                SB_Terminate (&Name);
+                Name = D->SVal;
                 InfoBits |= ibName;
                 NextToken (D);
                 break;
@@ -4388,7 +5488,7 @@ static void ParseSym (InputData* D)
     }
 
     /* Create the symbol info */
-    S = NewSymInfo (&Name);
+    S = NewSymInfo (D->Info->Mem, InternName (D, &Name));
     S->Id         = Id;
     S->Type       = Type;
     S->Value      = Value;
@@ -4397,8 +5497,8 @@ static void ParseSym (InputData* D)
     S->Seg.Id     = SegId;
     S->Scope.Id   = ScopeId;
     S->Parent.Id  = ParentId;
-    CollMove (&DefLineIds, &S->DefLineInfoList);
-    CollMove (&RefLineIds, &S->RefLineInfoList);
+    CollCopy (&S->DefLineInfoList, &DefLineIds);
+    CollCopy (&S->RefLineInfoList, &RefLineIds);
 
     /* Remember it */
     CollReplaceExpand (&D->Info->SymInfoById, S, Id);
@@ -4409,7 +5509,6 @@ ErrorExit:
     /* Entry point in case of errors */
     CollDone (&DefLineIds);
     CollDone (&RefLineIds);
-    SB_Done (&Name);
     return;
 }
 
@@ -4478,7 +5577,7 @@ static void ParseType (InputData* D)
                 if (!StrConstFollows (D)) {
                     goto ErrorExit;
                 }
-                SB_Copy (&Value, &D->SVal);
+                SB_CopyBuf (&Value, D->SVal.Ptr, D->SVal.Len);
                 InfoBits |= ibValue;
                 NextToken (D);
                 break;
@@ -4609,309 +5708,561 @@ ErrorExit:
 
 
 
-/*****************************************************************************/
-/*                              Data processing                              */
-/*****************************************************************************/
+static void ParseRecords (InputData* D)
+/* Parse record lines until end of input */
+{
+    while (D->Tok != TOK_EOF) {
 
+        /* Skip records of kinds that are not loaded */
+        if (RecordKind (D->Tok) & ~D->Records) {
+            SkipRecord (D);
+            ConsumeEOL (D);
+            continue;
+        }
 
+        switch (D->Tok) {
 
-static int FindCSymInfoByName (const Collection* CSymInfos, const char* Name,
-                               unsigned* Index)
-/* Find the C symbol info with a given file name. The function returns true if
-** the name was found. In this case, Index contains the index of the first item
-** that matches. If the item wasn't found, the function returns false and
-** Index contains the insert position for Name.
-*/
-{
-    /* Do a binary search */
-    int Lo = 0;
-    int Hi = (int) CollCount (CSymInfos) - 1;
-    int Found = 0;
-    while (Lo <= Hi) {
+            case TOK_CSYM:
+                ParseCSym (D);
+                break;
 
-        /* Mid of range */
-        int Cur = (Lo + Hi) / 2;
+            case TOK_FILE:
+                ParseFile (D);
+                break;
 
-        /* Get item */
-        const CSymInfo* CurItem = CollAt (CSymInfos, Cur);
+            case TOK_INFO:
+                ParseInfo (D);
+                break;
 
-        /* Compare */
-        int Res = strcmp (CurItem->Name, Name);
+            case TOK_LIBRARY:
+                ParseLibrary (D);
+                break;
 
-        /* Found? */
-        if (Res < 0) {
-            Lo = Cur + 1;
-        } else {
-            Hi = Cur - 1;
-            /* Since we may have duplicates, repeat the search until we've
-            ** the first item that has a match.
-            */
-            if (Res == 0) {
-                Found = 1;
-            }
-        }
-    }
+            case TOK_LINE:
+                ParseLine (D);
+                break;
 
-    /* Pass back the index. This is also the insert position */
-    *Index = Lo;
-    return Found;
-}
+            case TOK_MODULE:
+                ParseModule (D);
+                break;
 
+            case TOK_SCOPE:
+                ParseScope (D);
+                break;
 
+            case TOK_SEGMENT:
+                ParseSegment (D);
+                break;
 
-static int FindFileInfoByName (const Collection* FileInfos, const char* Name,
-                               unsigned* Index)
-/* Find the FileInfo for a given file name. The function returns true if the
-** name was found. In this case, Index contains the index of the first item
-** that matches. If the item wasn't found, the function returns false and
-** Index contains the insert position for Name.
-*/
-{
-    /* Do a binary search */
-    int Lo = 0;
-    int Hi = (int) CollCount (FileInfos) - 1;
-    int Found = 0;
-    while (Lo <= Hi) {
+            case TOK_SPAN:
+                ParseSpan (D);
+                break;
 
-        /* Mid of range */
-        int Cur = (Lo + Hi) / 2;
+            case TOK_SYM:
+                ParseSym (D);
+                break;
 
-        /* Get item */
-        const FileInfo* CurItem = CollAt (FileInfos, Cur);
+            case TOK_TYPE:
+                ParseType (D);
+                break;
 
-        /* Compare */
-        int Res = strcmp (CurItem->Name, Name);
+            case TOK_IDENT:
+                /* Output a warning, then skip the line with the unknown
+                ** keyword that may have been added by a later version.
+                */
+                ParseError (D, CC65_WARNING,
+                            "Unknown keyword \"%.*s\" - skipping",
+                            (int) D->SVal.Len, D->SVal.Ptr);
+
+                SkipLine (D);
+                break;
+
+            default:
+                UnexpectedToken (D);
 
-        /* Found? */
-        if (Res < 0) {
-            Lo = Cur + 1;
-        } else {
-            Hi = Cur - 1;
-            /* Since we may have duplicates, repeat the search until we've
-            ** the first item that has a match.
-            */
-            if (Res == 0) {
-                Found = 1;
-            }
         }
+
+        /* EOL or EOF must follow */
+        ConsumeEOL (D);
     }
 
-    /* Pass back the index. This is also the insert position */
-    *Index = Lo;
-    return Found;
 }
 
 
 
-static SpanInfoListEntry* FindSpanInfoByAddr (const SpanInfoList* L, cc65_addr Addr)
-/* Find the index of a SpanInfo for a given address. Returns 0 if no such
-** SpanInfo was found.
-*/
-{
-    /* Do a binary search */
-    int Lo = 0;
-    int Hi = (int) L->Count - 1;
-    while (Lo <= Hi) {
+/*****************************************************************************/
+/*                             Parallel parsing                              */
+/*****************************************************************************/
 
-        /* Mid of range */
-        int Cur = (Lo + Hi) / 2;
 
-        /* Get item */
-        SpanInfoListEntry* CurItem = &L->List[Cur];
 
-        /* Found? */
-        if (CurItem->Addr > Addr) {
-            Hi = Cur - 1;
-        } else if (CurItem->Addr < Addr) {
-            Lo = Cur + 1;
-        } else {
-            /* Found */
-            return CurItem;
-        }
-    }
+#if HAVE_THREADS
 
-    /* Not found */
-    return 0;
+static unsigned MaxThreadCount (void)
+/* Return the maximum number of threads to use */
+{
+    unsigned long Max = PARSE_THREADS;
+
+    if (Max == 0) {
+        long CPUs = sysconf (_SC_NPROCESSORS_ONLN);
+        Max = (CPUs > 0)? (unsigned long) CPUs : 1;
+    }
+    if (Max > MAX_PARSE_THREADS) {
+        Max = MAX_PARSE_THREADS;
+    }
+    return Max;
 }
 
 
 
-static int FindLineInfoByLine (const Collection* LineInfos, cc65_line Line,
-                               unsigned *Index)
-/* Find the LineInfo for a given line number. The function returns true if the
-** name was found. In this case, Index contains the index of the first item
-** that matches. If the item wasn't found, the function returns false and
-** Index contains the insert position for Name.
-*/
+static unsigned ParseThreadCount (size_t Size)
+/* Return the number of threads to use for parsing Size bytes of input */
 {
-    /* Do a binary search */
-    int Lo = 0;
-    int Hi = (int) CollCount (LineInfos) - 1;
-    int Found = 0;
-    while (Lo <= Hi) {
+    unsigned long Count = Size / PARSE_CHUNK_SIZE;
+    unsigned long Max   = MaxThreadCount ();
+    return (Count < Max)? Count : Max;
+}
 
-        /* Mid of range */
-        int Cur = (Lo + Hi) / 2;
 
-        /* Get item */
-        LineInfo* CurItem = CollAt (LineInfos, Cur);
 
-        /* Found? */
-        if (Line > CurItem->Line) {
-            Lo = Cur + 1;
-        } else {
-            Hi = Cur - 1;
-            /* Since we may have duplicates, repeat the search until we've
-            ** the first item that has a match.
-            */
-            if(Line == CurItem->Line) {
-                Found = 1;
-            }
-        }
-    }
+static void* ParseChunk (void* Arg)
+/* Thread function: Parse all record lines in one chunk of the input */
+{
+    InputData* D = Arg;
 
-    /* Pass back the index. This is also the insert position */
-    *Index = Lo;
-    return Found;
+    NextToken (D);
+    ParseRecords (D);
+    return 0;
 }
 
 
 
-static SegInfo* FindSegInfoByName (const Collection* SegInfos, const char* Name)
-/* Find the SegInfo for a given segment name. The function returns the segment
-** info or NULL if none was found.
+static int ParseParallel (InputData* D)
+/* Parse the remainder of the input in chunks on several threads, then merge
+** the results into D->Info. D must be positioned at the start of a line.
+** Every record is a line of its own with an explicit id, so the chunks can
+** be parsed independently. If the input is not suitable for parallel
+** parsing, return false without doing anything.
 */
 {
-    /* Do a binary search */
-    int Lo = 0;
-    int Hi = (int) CollCount (SegInfos) - 1;
-    while (Lo <= Hi) {
+    InputData   Chunks[MAX_PARSE_THREADS];
+    Collection  Errors[MAX_PARSE_THREADS];
+    pthread_t   Threads[MAX_PARSE_THREADS];
+    int         Started[MAX_PARSE_THREADS];
+    const char* Start = D->Pos;
+    cc65_line   Line;
+    unsigned    Count;
+    unsigned    I, J;
+
+    /* Only input that is completely in memory is parsed in parallel */
+    if (D->F != 0) {
+        return 0;
+    }
+    Count = ParseThreadCount (D->End - Start);
+    if (Count < 2) {
+        return 0;
+    }
 
-        /* Mid of range */
-        int Cur = (Lo + Hi) / 2;
+    /* Split the input into chunks of about the same size at line ends */
+    for (I = 0; I < Count; ++I) {
 
-        /* Get item */
-        SegInfo* CurItem = CollAt (SegInfos, Cur);
+        InputData*  C = &Chunks[I];
+        const char* End = D->End;
 
-        /* Compare */
-        int Res = strcmp (CurItem->Name, Name);
+        if (I < Count - 1) {
+            End = Start + (D->End - Start) / (Count - I);
+            End = memchr (End, '\n', D->End - End);
+            End = End? End + 1 : D->End;
+        }
 
-        /* Found? */
-        if (Res < 0) {
-            Lo = Cur + 1;
-        } else if (Res > 0) {
-            Hi = Cur - 1;
+        /* Each chunk has its own scanner state, debug info and error list */
+        *C = *D;
+        C->Line      = 1;
+        C->Errors    = 0;
+        C->MapSize   = 0;
+        C->Buf       = C->Pos = C->LineStart = Start;
+        C->End       = End;
+        C->Block     = 0;
+        C->C         = ' ';
+        C->Tok       = TOK_INVALID;
+        C->Deferred  = CollInit (&Errors[I]);
+        C->Info      = NewDbgInfo (D->FileName);
+
+        Start = End;
+    }
+
+    /* Parse the first chunk ourselves, the others on worker threads. If a
+    ** thread cannot be started, its chunk is parsed here instead.
+    */
+    for (I = 1; I < Count; ++I) {
+        Started[I] = (pthread_create (&Threads[I], 0, ParseChunk, &Chunks[I]) == 0);
+    }
+    ParseChunk (&Chunks[0]);
+    for (I = 1; I < Count; ++I) {
+        if (Started[I]) {
+            pthread_join (Threads[I], 0);
         } else {
-            /* Found */
-            return CurItem;
+            ParseChunk (&Chunks[I]);
+        }
+    }
+
+    /* Report errors with the line number in the file, and merge the records.
+    ** Both must be done in input order.
+    */
+    Line = D->Line;
+    for (I = 0; I < Count; ++I) {
+
+        InputData* C = &Chunks[I];
+
+        for (J = 0; J < CollCount (&Errors[I]); ++J) {
+            cc65_parseerror* E = CollAt (&Errors[I], J);
+            E->line += Line - 1;
+            D->Error (E);
+            xfree (E);
         }
+        CollDone (&Errors[I]);
+        D->Errors += C->Errors;
+        Line      += C->Line - 1;
+
+        MergeDbgInfo (D->Info, C->Info);
     }
 
-    /* Not found */
+    /* We're at the end of the input */
+    D->Line = Line;
+    D->Pos  = D->LineStart = D->End;
+    D->C    = EOF;
+    D->Tok  = TOK_EOF;
+    return 1;
+}
+
+#else
+
+static int ParseParallel (InputData* D)
+/* Without thread support, parsing is never done in parallel */
+{
+    (void) D;
     return 0;
 }
 
+#endif
 
 
-static int FindScopeInfoByName (const Collection* ScopeInfos, const char* Name,
-                                unsigned* Index)
-/* Find the ScopeInfo for a given scope name. The function returns true if the
-** name was found. In this case, Index contains the index of the first item
-** that matches. If the item wasn't found, the function returns false and
-** Index contains the insert position for Name.
-*/
-{
-    /* Do a binary search */
-    int Lo = 0;
-    int Hi = (int) CollCount (ScopeInfos) - 1;
-    int Found = 0;
-    while (Lo <= Hi) {
 
-        /* Mid of range */
-        int Cur = (Lo + Hi) / 2;
+/*****************************************************************************/
+/*                                  Sorting                                  */
+/*****************************************************************************/
 
-        /* Get item */
-        const ScopeInfo* CurItem = CollAt (ScopeInfos, Cur);
 
-        /* Compare */
-        int Res = strcmp (CurItem->Name, Name);
 
-        /* Found? */
-        if (Res < 0) {
-            Lo = Cur + 1;
-        } else {
-            Hi = Cur - 1;
-            /* Since we may have duplicates, repeat the search until we've
-            ** the first item that has a match.
-            */
-            if (Res == 0) {
-                Found = 1;
-            }
-        }
+static void QueueSortJob (Collection* Sorts, Collection* C,
+                          int (*Compare) (const void*, const void*),
+                          void (*KeySort) (Collection*))
+/* Add a job that sorts a whole collection to a list run by RunSorts. There
+** is nothing to do for collections with less than two items.
+*/
+{
+    SortJob* J;
+    if (CollCount (C) < 2) {
+        return;
     }
+    J = xmalloc (sizeof (SortJob));
+    J->C       = C;
+    J->Compare = Compare;
+    J->KeySort = KeySort;
+    J->Tmp     = 0;
+    CollAppend (Sorts, J);
+}
 
-    /* Pass back the index. This is also the insert position */
-    *Index = Lo;
-    return Found;
+
+
+static void QueueSort (InputData* D, Collection* C,
+                       int (*Compare) (const void*, const void*))
+/* Queue sorting a collection with a compare function. The sorts are done
+** by RunSorts, so the collection must be complete and must not be used
+** before. The function
+** must never return zero for two different items, so the result doesn't
+** depend on the way the items are sorted.
+*/
+{
+    QueueSortJob (&D->Sorts, C, Compare, 0);
 }
 
 
 
-static int FindSymInfoByName (const Collection* SymInfos, const char* Name,
-                              unsigned* Index)
-/* Find the SymInfo for a given file name. The function returns true if the
-** name was found. In this case, Index contains the index of the first item
-** that matches. If the item wasn't found, the function returns false and
-** Index contains the insert position for Name.
+static void DeferSort (InputData* D, IndexKind Index, Collection* C,
+                       int (*Compare) (const void*, const void*))
+/* Like QueueSort, but sort the collection when the given index is built,
+** see NeedIndex.
 */
 {
-    /* Do a binary search */
-    int Lo = 0;
-    int Hi = (int) CollCount (SymInfos) - 1;
-    int Found = 0;
-    while (Lo <= Hi) {
+    QueueSortJob (&D->Info->Sorts[Index], C, Compare, 0);
+}
 
-        /* Mid of range */
-        int Cur = (Lo + Hi) / 2;
 
-        /* Get item */
-        const SymInfo* CurItem = CollAt (SymInfos, Cur);
 
-        /* Compare */
-        int Res = strcmp (CurItem->Name, Name);
+static void DeferKeySort (InputData* D, IndexKind Index, Collection* C,
+                          void (*KeySort) (Collection*))
+/* Like DeferSort, but sort with a function that sorts all of the collection */
+{
+    QueueSortJob (&D->Info->Sorts[Index], C, 0, KeySort);
+}
 
-        /* Found? */
-        if (Res < 0) {
-            Lo = Cur + 1;
+
+
+static void RunSortJob (SortJob* J)
+/* Sort or merge the items of one job */
+{
+    CollEntry* Items = J->C->Items;
+
+    if (J->Mid != J->Lo) {
+
+        /* Merge both halves into Tmp, then copy the result back */
+        unsigned I = J->Lo;
+        unsigned K = J->Mid;
+        unsigned O = J->Lo;
+        while (I < J->Mid && K < J->Hi) {
+            if (J->Compare (Items[K].Ptr, Items[I].Ptr) < 0) {
+                J->Tmp[O++] = Items[K++];
+            } else {
+                J->Tmp[O++] = Items[I++];
+            }
+        }
+        while (I < J->Mid) {
+            J->Tmp[O++] = Items[I++];
+        }
+        while (K < J->Hi) {
+            J->Tmp[O++] = Items[K++];
+        }
+        memcpy (Items + J->Lo, J->Tmp + J->Lo, (J->Hi - J->Lo) * sizeof (CollEntry));
+
+    } else if (J->KeySort) {
+        J->KeySort (J->C);
+    } else if (J->Hi - J->Lo > 1) {
+        /* Allow twice the depth of a perfectly balanced quicksort */
+        unsigned Depth = 0;
+        unsigned Count;
+        for (Count = J->Hi - J->Lo; Count > 1; Count >>= 1) {
+            Depth += 2;
+        }
+        CollIntroSort (Items, J->Lo, J->Hi - 1, Depth, J->Compare);
+    }
+}
+
+
+
+#if HAVE_THREADS
+
+/* A list of jobs worked on by several threads */
+typedef struct SortPool SortPool;
+struct SortPool {
+    const Collection*   Jobs;           /* The jobs */
+    unsigned            Next;           /* Next job to run */
+    pthread_mutex_t     Lock;           /* Protects Next */
+};
+
+
+
+static void* SortWorker (void* Arg)
+/* Thread function: Run jobs from the pool until there are no more */
+{
+    SortPool* P = Arg;
+    while (1) {
+        unsigned I;
+        pthread_mutex_lock (&P->Lock);
+        I = P->Next++;
+        pthread_mutex_unlock (&P->Lock);
+        if (I >= CollCount (P->Jobs)) {
+            break;
+        }
+        RunSortJob (CollAt (P->Jobs, I));
+    }
+    return 0;
+}
+
+
+
+static void RunSortJobs (const Collection* Jobs, unsigned Threads)
+/* Run a list of jobs on up to the given number of threads, and return when
+** all of them are done. Jobs are started in list order.
+*/
+{
+    pthread_t Workers[MAX_PARSE_THREADS];
+    int       Started[MAX_PARSE_THREADS];
+    SortPool  P;
+    unsigned  I;
+
+    P.Jobs  = Jobs;
+    P.Next  = 0;
+    pthread_mutex_init (&P.Lock, 0);
+
+    /* The current thread is one of the workers */
+    if (Threads > CollCount (Jobs)) {
+        Threads = CollCount (Jobs);
+    }
+    for (I = 1; I < Threads; ++I) {
+        Started[I] = (pthread_create (&Workers[I], 0, SortWorker, &P) == 0);
+    }
+    SortWorker (&P);
+    for (I = 1; I < Threads; ++I) {
+        if (Started[I]) {
+            pthread_join (Workers[I], 0);
+        }
+    }
+
+    pthread_mutex_destroy (&P.Lock);
+}
+
+
+
+static int CompareSortJobSize (const void* L, const void* R)
+/* Helper function to sort jobs by descending size */
+{
+    unsigned LSize = ((const SortJob*) L)->Hi - ((const SortJob*) L)->Lo;
+    unsigned RSize = ((const SortJob*) R)->Hi - ((const SortJob*) R)->Lo;
+    return (LSize < RSize)? 1 : (LSize > RSize)? -1 : 0;
+}
+
+
+
+static int RunSortsParallel (Collection* Sorts, unsigned long Items)
+/* Run the sorts in the list on several threads. Large collections are split
+** into one part per thread, and the sorted parts are then merged pairwise.
+** Return false without doing anything if it's not worth it.
+*/
+{
+    Collection Jobs  = COLLECTION_INITIALIZER;
+    Collection Parts = COLLECTION_INITIALIZER;
+    unsigned   Threads = MaxThreadCount ();
+    unsigned   Width;
+    unsigned   I, K;
+
+    if (Threads < 2 || Items < PARALLEL_SORT_ITEMS) {
+        return 0;
+    }
+
+    /* Create the sort jobs, splitting the large collections */
+    for (I = 0; I < CollCount (Sorts); ++I) {
+        SortJob* J = CollAt (Sorts, I);
+        if (J->Compare && J->Hi >= SPLIT_SORT_ITEMS) {
+            J->Tmp = xmalloc (J->Hi * sizeof (CollEntry));
+            for (K = 0; K < Threads; ++K) {
+                SortJob* P = xmalloc (sizeof (SortJob));
+                *P = *J;
+                P->Lo  = P->Mid = (unsigned) ((unsigned long) J->Hi * K / Threads);
+                P->Hi  = (unsigned) ((unsigned long) J->Hi * (K + 1) / Threads);
+                CollAppend (&Parts, P);
+                CollAppend (&Jobs, P);
+            }
         } else {
-            Hi = Cur - 1;
-            /* Since we may have duplicates, repeat the search until we've
-            ** the first item that has a match.
-            */
-            if (Res == 0) {
-                Found = 1;
+            CollAppend (&Jobs, J);
+        }
+    }
+
+    /* Start with the largest jobs, so the small ones fill the gaps at the
+    ** end.
+    */
+    CollSort (&Jobs, CompareSortJobSize);
+    RunSortJobs (&Jobs, Threads);
+
+    /* Merge the parts of the large collections. Parts are in order, so
+    ** K and K + Width are neighbours of the same collection if K is a
+    ** multiple of 2 * Width within the threads of a collection.
+    */
+    for (Width = 1; Width < Threads; Width *= 2) {
+        CollDeleteAll (&Jobs);
+        for (I = 0; I < CollCount (&Parts); I += Threads) {
+            for (K = 0; K + Width < Threads; K += 2 * Width) {
+                SortJob* L = CollAt (&Parts, I + K);
+                SortJob* R = CollAt (&Parts, I + K + Width);
+                unsigned End = (K + 2 * Width < Threads)? K + 2 * Width : Threads;
+                L->Mid = R->Lo;
+                L->Hi  = ((SortJob*) CollAt (&Parts, I + End - 1))->Hi;
+                CollAppend (&Jobs, L);
             }
         }
+        RunSortJobs (&Jobs, Threads);
     }
 
-    /* Pass back the index. This is also the insert position */
-    *Index = Lo;
-    return Found;
+    /* Free the parts and the temporary storage */
+    for (I = 0; I < CollCount (&Parts); ++I) {
+        SortJob* P = CollAt (&Parts, I);
+        if (I % Threads == 0) {
+            xfree (P->Tmp);
+        }
+        xfree (P);
+    }
+    CollDone (&Parts);
+    CollDone (&Jobs);
+    return 1;
 }
 
+#endif
 
 
-static int FindSymInfoByValue (const Collection* SymInfos, long Value,
+
+static void RunSorts (Collection* Sorts)
+/* Run all sorts in a list built with QueueSort or DeferSort, and empty it.
+** Sorts of different collections don't depend on each other, so they're run
+** on several threads if possible.
+*/
+{
+    unsigned long Items = 0;
+    unsigned I;
+
+    /* The collections are complete now, so we know their sizes */
+    for (I = 0; I < CollCount (Sorts); ++I) {
+        SortJob* J = CollAt (Sorts, I);
+        J->Lo  = J->Mid = 0;
+        J->Hi  = CollCount (J->C);
+        Items += J->Hi;
+    }
+
+#if HAVE_THREADS
+    if (!RunSortsParallel (Sorts, Items))
+#endif
+    {
+        for (I = 0; I < CollCount (Sorts); ++I) {
+            RunSortJob (CollAt (Sorts, I));
+        }
+    }
+
+    /* Free the jobs */
+    for (I = 0; I < CollCount (Sorts); ++I) {
+        xfree (CollAt (Sorts, I));
+    }
+    CollDone (Sorts);
+}
+
+
+
+/*****************************************************************************/
+/*                              Data processing                              */
+/*****************************************************************************/
+
+
+
+static const char* PooledName (const DbgInfo* Info, const char* Name)
+/* Return the copy of Name in the name pool of the debug info, or NULL if no
+** item has this name. Name lookups by pointer expect pooled names.
+*/
+{
+    const PoolStr* E = SP_Find (&Info->Names, Name);
+    return E? E->Str : 0;
+}
+
+
+
+static int FindFileInfoByName (const Collection* FileInfos, const char* Name,
                                unsigned* Index)
-/* Find the SymInfo for a given value. The function returns true if the
-** value was found. In this case, Index contains the index of the first item
+/* Find the FileInfo for a given file name. The function returns true if the
+** name was found. In this case, Index contains the index of the first item
 ** that matches. If the item wasn't found, the function returns false and
-** Index contains the insert position for the given value.
+** Index contains the insert position for Name.
 */
 {
     /* Do a binary search */
     int Lo = 0;
-    int Hi = (int) CollCount (SymInfos) - 1;
+    int Hi = (int) CollCount (FileInfos) - 1;
     int Found = 0;
     while (Lo <= Hi) {
 
@@ -4919,17 +6270,20 @@ static int FindSymInfoByValue (const Collection* SymInfos, long Value,
         int Cur = (Lo + Hi) / 2;
 
         /* Get item */
-        SymInfo* CurItem = CollAt (SymInfos, Cur);
+        const FileInfo* CurItem = CollAt (FileInfos, Cur);
+
+        /* Compare */
+        int Res = CompareNames (CurItem->Name, Name);
 
         /* Found? */
-        if (Value > CurItem->Value) {
+        if (Res < 0) {
             Lo = Cur + 1;
         } else {
             Hi = Cur - 1;
             /* Since we may have duplicates, repeat the search until we've
             ** the first item that has a match.
             */
-            if (Value == CurItem->Value) {
+            if (Res == 0) {
                 Found = 1;
             }
         }
@@ -4942,163 +6296,572 @@ static int FindSymInfoByValue (const Collection* SymInfos, long Value,
 
 
 
-static void ProcessCSymInfo (InputData* D)
-/* Postprocess c symbol infos */
+static unsigned FindSpansInTree (const SpanInfoListEntry* List, unsigned Lo,
+                                 unsigned Hi, cc65_addr Addr,
+                                 cc65_spandata* Data, const SpanInfo** Spans)
+/* Search the subtree with the entries from Lo to Hi - 1 for spans that
+** cover Addr. See FindSpanInfoByAddr.
+*/
 {
-    unsigned I;
-
-    /* Walk over all c symbols. Resolve the ids and add the c symbols to the
-    ** corresponding asm symbols.
-    */
-    for (I = 0; I < CollCount (&D->Info->CSymInfoById); ++I) {
-
-        /* Get this c symbol info */
-        CSymInfo* S = CollAt (&D->Info->CSymInfoById, I);
+    unsigned Count = 0;
+    while (Lo < Hi) {
 
-        /* Resolve the asm symbol */
-        if (S->Sym.Id == CC65_INV_ID) {
-            S->Sym.Info = 0;
-        } else if (S->Sym.Id >= CollCount (&D->Info->SymInfoById)) {
-            ParseError (D,
-                        CC65_ERROR,
-                        "Invalid symbol id %u for c symbol with id %u",
-                        S->Sym.Id, S->Id);
-            S->Sym.Info = 0;
-        } else {
-            S->Sym.Info = CollAt (&D->Info->SymInfoById, S->Sym.Id);
+        /* Root of the subtree */
+        unsigned Mid = Lo + (Hi - Lo) / 2;
+        const SpanInfoListEntry* E = &List[Mid];
 
-            /* For normal (=static) symbols, add a backlink to the symbol but
-            ** check that there is not more than one.
-            */
-            if (S->SC != CC65_CSYM_AUTO && S->SC != CC65_CSYM_REG) {
-                if (S->Sym.Info->CSym) {
-                    ParseError (D,
-                                CC65_ERROR,
-                                "Asm symbol id %u has more than one C symbol attached",
-                                S->Sym.Info->Id);
-                    S->Sym.Info = 0;
-                } else {
-                    S->Sym.Info->CSym = S;
-                }
-            }
+        /* If everything in the subtree ends below Addr, we're done */
+        if (E->MaxEnd < Addr) {
+            break;
         }
 
-        /* Resolve the type */
-        if (S->Type.Id >= CollCount (&D->Info->TypeInfoById)) {
-            ParseError (D,
-                        CC65_ERROR,
-                        "Invalid type id %u for c symbol with id %u",
-                        S->Type.Id, S->Id);
-            S->Type.Info = 0;
-        } else {
-            S->Type.Info = CollAt (&D->Info->TypeInfoById, S->Type.Id);
-        }
+        /* Search the left subtree, which has the lower start addresses */
+        Count += FindSpansInTree (List, Lo, Mid, Addr,
+                                  Data? Data + Count : 0,
+                                  Spans? Spans + Count : 0);
 
-        /* Resolve the scope */
-        if (S->Scope.Id >= CollCount (&D->Info->ScopeInfoById)) {
-            ParseError (D,
-                        CC65_ERROR,
-                        "Invalid scope id %u for c symbol with id %u",
-                        S->Scope.Id, S->Id);
-            S->Scope.Info = 0;
-        } else {
-            S->Scope.Info = CollAt (&D->Info->ScopeInfoById, S->Scope.Id);
+        /* The root and everything right of it start above Addr */
+        if (E->Start > Addr) {
+            break;
+        }
 
-            /* Add the c symbol to the list of all c symbols for this scope */
-            if (S->Scope.Info->CSymInfoByName == 0) {
-                S->Scope.Info->CSymInfoByName = CollNew ();
+        /* Check the root itself */
+        if (E->End >= Addr) {
+            if (Data) {
+                CopySpanInfo (Data + Count, E->Span);
             }
-            CollAppend (S->Scope.Info->CSymInfoByName, S);
-
-            /* If the scope has an owner symbol, it's a .PROC scope. If this
-            ** symbol is identical to the one attached to the C symbol, this
-            ** is actuallay a C function and the scope is the matching scope.
-            ** Remember the C symbol in the scope in this case.
-            ** Beware: Scopes haven't been postprocessed, so we don't have a
-            ** pointer but just an id.
-            */
-            if (S->Sym.Info && S->Scope.Info->Label.Id == S->Sym.Info->Id) {
-                /* This scope is our function scope */
-                S->Scope.Info->CSymFunc = S;
-                /* Add it to the list of all c functions */
-                CollAppend (&D->Info->CSymFuncByName, S);
+            if (Spans) {
+                Spans[Count] = E->Span;
             }
-
+            ++Count;
         }
+
+        /* Continue with the right subtree */
+        Lo = Mid + 1;
     }
 
-    /* Walk over all scopes and sort the c symbols by name. */
-    for (I = 0; I < CollCount (&D->Info->ScopeInfoById); ++I) {
+    /* Return the number of spans found */
+    return Count;
+}
 
-        /* Get this scope */
-        ScopeInfo* S = CollAt (&D->Info->ScopeInfoById, I);
 
-        /* Ignore scopes without C symbols */
-        if (CollCount (S->CSymInfoByName) > 1) {
-            /* Sort the c symbols for this scope by name */
-            CollSort (S->CSymInfoByName, CompareCSymInfoByName);
-        }
-    }
 
-    /* Sort the main list of all C functions by name */
-    CollSort (&D->Info->CSymFuncByName, CompareCSymInfoByName);
+static unsigned FindSpanInfoByAddr (const SpanInfoList* L, cc65_addr Addr,
+                                    cc65_spandata* Data, const SpanInfo** Spans)
+/* Find the spans that cover the given address and return their number. The
+** spans are sorted by start and then by end address. If Data is not NULL,
+** they are copied to it, if Spans is not NULL, pointers to them are stored
+** there.
+*/
+{
+    return FindSpansInTree (L->List, 0, L->Count, Addr, Data, Spans);
 }
 
 
 
-static void ProcessFileInfo (InputData* D)
-/* Postprocess file infos */
+static int CompareAddr (const void* L, const void* R)
+/* Helper function to sort addresses */
 {
-    /* Walk over all file infos and resolve the module ids */
-    unsigned I;
-    for (I = 0; I < CollCount (&D->Info->FileInfoById); ++I) {
+    cc65_addr Left  = *(const cc65_addr*) L;
+    cc65_addr Right = *(const cc65_addr*) R;
+    return (Left < Right)? -1 : (Left > Right);
+}
 
-        /* Get this file info */
-        FileInfo* F = CollAt (&D->Info->FileInfoById, I);
 
-        /* Resolve the module ids */
-        unsigned J;
-        for (J = 0; J < CollCount (&F->ModInfoByName); ++J) {
 
-            /* Get the id of this module */
-            unsigned ModId = CollIdAt (&F->ModInfoByName, J);
-            if (ModId >= CollCount (&D->Info->ModInfoById)) {
-                ParseError (D,
-                            CC65_ERROR,
-                            "Invalid module id %u for file with id %u",
-                            ModId, F->Id);
-                CollReplace (&F->ModInfoByName, 0, J);
-            } else {
+static void CreateAddrMap (AddrMap* M, const SpanInfoList* L)
+/* Create the address map for the spans in L, if it fits into the budget of
+** the map.
+*/
+{
+    cc65_addr*    Bounds;
+    unsigned      BoundCount;
+    unsigned      GroupCount;
+    unsigned long SpanCount;
+    unsigned long Bytes;
+    cc65_addr     Last;
+    unsigned      I, J;
 
-                /* Get a pointer to the module */
-                ModInfo* M = CollAt (&D->Info->ModInfoById, ModId);
+    if (L->Count == 0) {
+        return;
+    }
 
-                /* Replace the id by the pointer */
-                CollReplace (&F->ModInfoByName, M, J);
+    /* The table covers the range from the lowest start address to the
+    ** highest end address. The first entry has the lowest start address,
+    ** and the root of the tree knows the highest end address.
+    */
+    M->Base = L->List[0].Start;
+    Last    = L->List[L->Count / 2].MaxEnd;
+    if (Last - M->Base >= M->Budget / sizeof (unsigned)) {
+        /* Too large */
+        return;
+    }
+    M->Size = (unsigned long) (Last - M->Base) + 1;
 
-                /* Insert a backpointer into the module */
-                CollAppend (&M->FileInfoByName, F);
-            }
+    /* The spans covering an address change only where a span starts or
+    ** after one ends. Collect these boundaries in ascending order.
+    */
+    Bounds = xmalloc (2 * L->Count * sizeof (cc65_addr));
+    BoundCount = 0;
+    for (I = 0; I < L->Count; ++I) {
+        Bounds[BoundCount++] = L->List[I].Start;
+        if (L->List[I].End < Last) {
+            Bounds[BoundCount++] = L->List[I].End + 1;
         }
-
-        /* If we didn't have any errors, sort the modules by name */
-        if (D->Errors == 0) {
-            CollSort (&F->ModInfoByName, CompareModInfoByName);
+    }
+    qsort (Bounds, BoundCount, sizeof (cc65_addr), CompareAddr);
+    for (I = 1, J = 1; I < BoundCount; ++I) {
+        if (Bounds[I] != Bounds[J-1]) {
+            Bounds[J++] = Bounds[I];
         }
     }
+    BoundCount = J;
 
-    /* Now walk over all modules and sort the file infos by name */
-    for (I = 0; I < CollCount (&D->Info->ModInfoById); ++I) {
-
-        /* Get this module info */
-        ModInfo* M = CollAt (&D->Info->ModInfoById, I);
-
-        /* Sort the files by name */
-        CollSort (&M->FileInfoByName, CompareFileInfoByName);
+    /* Count the groups and spans to check the budget */
+    GroupCount = 1;
+    SpanCount  = 0;
+    for (I = 0; I < BoundCount; ++I) {
+        unsigned Count = FindSpanInfoByAddr (L, Bounds[I], 0, 0);
+        if (Count > 0) {
+            ++GroupCount;
+            SpanCount += Count;
+        }
+    }
+    Bytes = M->Size * sizeof (unsigned) +
+            (GroupCount + 1) * sizeof (unsigned) +
+            SpanCount * sizeof (SpanInfo*);
+    if (Bytes > M->Budget) {
+        /* Too large */
+        xfree (Bounds);
+        M->Size = 0;
+        return;
+    }
+
+    /* Create the table. Every range between two boundaries gets a new group
+    ** if there are spans for it, or the empty group 0 otherwise.
+    */
+    M->Slots     = xmalloc (M->Size * sizeof (unsigned));
+    M->Groups    = xmalloc ((GroupCount + 1) * sizeof (unsigned));
+    M->Spans     = xmalloc (SpanCount * sizeof (SpanInfo*));
+    M->Groups[0] = 0;
+    M->Groups[1] = 0;
+    GroupCount   = 1;
+    for (I = 0; I < BoundCount; ++I) {
+
+        /* Range of addresses up to the next boundary */
+        unsigned long First = Bounds[I] - M->Base;
+        unsigned long End   = (I + 1 < BoundCount)? Bounds[I+1] - M->Base : M->Size;
+
+        /* Enter the spans for this range */
+        unsigned Group = 0;
+        unsigned Count = FindSpanInfoByAddr (L, Bounds[I], 0,
+                                             M->Spans + M->Groups[GroupCount]);
+        if (Count > 0) {
+            Group = GroupCount++;
+            M->Groups[GroupCount] = M->Groups[Group] + Count;
+        }
+        while (First < End) {
+            M->Slots[First++] = Group;
+        }
+    }
+
+    /* Free the boundaries */
+    xfree (Bounds);
+}
+
+
+
+static void SortSpans (DbgInfo* Info)
+/* Create the collection with the spans in Info sorted by address */
+{
+    unsigned I;
+
+    CollGrow (&Info->SpanInfoByStart, CollCount (&Info->SpanInfoById));
+    for (I = 0; I < CollCount (&Info->SpanInfoById); ++I) {
+        CollAppend (&Info->SpanInfoByStart, CollAt (&Info->SpanInfoById, I));
+    }
+    SortSpanInfoByAddr (&Info->SpanInfoByStart);
+}
+
+
+
+static void IndexSpans (DbgInfo* Info)
+/* Create the span info list for the spans in Info, and the address map if
+** it fits into its budget. The spans must already be sorted by address.
+*/
+{
+    /* Create the span info list from the sorted spans, then the address map
+    ** from the list.
+    */
+    CreateSpanInfoList (&Info->SpanInfoByAddr, &Info->SpanInfoByStart);
+    CreateAddrMap (&Info->SpanMap, &Info->SpanInfoByAddr);
+}
+
+
+
+static const AddrMap* GetSpanMap (const DbgInfo* Info)
+/* Return the address map for the spans in Info, or NULL if there is none,
+** because it wouldn't fit into the budget. The span index must exist. The
+** map is only ever created together with it by IndexSpans, with the lock
+** held, so queries never modify it.
+*/
+{
+    assert (Info->SpanInfoByAddr.Count == CollCount (&Info->SpanInfoById));
+    return Info->SpanMap.Slots? &Info->SpanMap : 0;
+}
+
+
+
+static const SpanInfo** FindSpansInAddrMap (const AddrMap* M, cc65_addr Addr,
+                                            unsigned* Count)
+/* Return the spans for an address from an address map, and their number in
+** Count. The spans are sorted as with FindSpanInfoByAddr.
+*/
+{
+    unsigned Group = 0;
+    if (Addr >= M->Base && Addr - M->Base < M->Size) {
+        Group = M->Slots[Addr - M->Base];
+    }
+    *Count = M->Groups[Group+1] - M->Groups[Group];
+    return M->Spans + M->Groups[Group];
+}
+
+
+
+static int FindLineInfoByLine (const Collection* LineInfos, cc65_line Line,
+                               unsigned *Index)
+/* Find the LineInfo for a given line number. The function returns true if the
+** name was found. In this case, Index contains the index of the first item
+** that matches. If the item wasn't found, the function returns false and
+** Index contains the insert position for Name.
+*/
+{
+    /* Do a binary search */
+    int Lo = 0;
+    int Hi = (int) CollCount (LineInfos) - 1;
+    int Found = 0;
+    while (Lo <= Hi) {
+
+        /* Mid of range */
+        int Cur = (Lo + Hi) / 2;
+
+        /* Get item */
+        LineInfo* CurItem = CollAt (LineInfos, Cur);
+
+        /* Found? */
+        if (Line > CurItem->Line) {
+            Lo = Cur + 1;
+        } else {
+            Hi = Cur - 1;
+            /* Since we may have duplicates, repeat the search until we've
+            ** the first item that has a match.
+            */
+            if(Line == CurItem->Line) {
+                Found = 1;
+            }
+        }
+    }
+
+    /* Pass back the index. This is also the insert position */
+    *Index = Lo;
+    return Found;
+}
+
+
+
+static int FindSegInfoByAddr (const Collection* SegInfos, cc65_addr Addr,
+                              unsigned* Index)
+/* Find the segment that contains Addr in a collection of segment infos
+** sorted by address, see IndexSegs. The function returns true if there is
+** one, and Index contains its index. If segments overlap, as banked segments
+** may, the one with the highest start address wins.
+*/
+{
+    /* Do a binary search for the first segment that starts above Addr */
+    unsigned Lo = 0;
+    unsigned Hi = CollCount (SegInfos);
+    while (Lo < Hi) {
+        unsigned Cur = (Lo + Hi) / 2;
+        if (((const SegInfo*) CollAt (SegInfos, Cur))->Start <= Addr) {
+            Lo = Cur + 1;
+        } else {
+            Hi = Cur;
+        }
+    }
+
+    /* Check the segments that start at or below Addr, nearest first. Stop
+    ** as soon as none of them ends above Addr, so an address in a gap costs
+    ** no more than the search. Only overlapping segments are walked.
+    */
+    while (Lo > 0) {
+        const SegInfo* S = CollAt (SegInfos, --Lo);
+        if (S->MaxEnd <= Addr) {
+            break;
+        }
+        if (Addr - S->Start < S->Size) {
+            *Index = Lo;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+
+static int FindSymInfoByValue (const Collection* SymInfos, long Value,
+                               unsigned* Index)
+/* Find the SymInfo for a given value. The function returns true if the
+** value was found. In this case, Index contains the index of the first item
+** that matches. If the item wasn't found, the function returns false and
+** Index contains the insert position for the given value.
+*/
+{
+    /* Do a binary search */
+    int Lo = 0;
+    int Hi = (int) CollCount (SymInfos) - 1;
+    int Found = 0;
+    while (Lo <= Hi) {
+
+        /* Mid of range */
+        int Cur = (Lo + Hi) / 2;
+
+        /* Get item */
+        SymInfo* CurItem = CollAt (SymInfos, Cur);
+
+        /* Found? */
+        if (Value > CurItem->Value) {
+            Lo = Cur + 1;
+        } else {
+            Hi = Cur - 1;
+            /* Since we may have duplicates, repeat the search until we've
+            ** the first item that has a match.
+            */
+            if (Value == CurItem->Value) {
+                Found = 1;
+            }
+        }
+    }
+
+    /* Pass back the index. This is also the insert position */
+    *Index = Lo;
+    return Found;
+}
+
+
+
+static unsigned FindLabelsInRange (const DbgInfo* Info, cc65_addr Start,
+                                   cc65_addr End, unsigned* Index)
+/* Find the labels with values from Start to End, which is inclusive. The
+** function returns their number, and in Index the index of the first one in
+** LabelInfoByVal.
+*/
+{
+    unsigned I;
+
+    /* Search for the start, then walk up to the end of the range */
+    FindSymInfoByValue (&Info->LabelInfoByVal, Start, Index);
+    for (I = *Index; I < CollCount (&Info->LabelInfoByVal); ++I) {
+        const SymInfo* S = CollAt (&Info->LabelInfoByVal, I);
+        if (S->Value > (long) End) {
+            break;
+        }
+    }
+    return I - *Index;
+}
+
+
+
+static const SymInfo* FindLabelBelow (const DbgInfo* Info, cc65_addr Addr)
+/* Return the label with the highest value at or below Addr, or NULL if there
+** is none. If several labels have this value, the first one in
+** LabelInfoByVal is returned.
+*/
+{
+    const SymInfo* S;
+    unsigned Index;
+
+    /* Search for the address. If there's no label with this value, the one
+    ** before the insert position is the nearest one below.
+    */
+    if (FindSymInfoByValue (&Info->LabelInfoByVal, (long) Addr, &Index)) {
+        return CollAt (&Info->LabelInfoByVal, Index);
+    }
+    if (Index == 0) {
+        return 0;
+    }
+
+    /* Search again for the first label with the value of this one */
+    S = CollAt (&Info->LabelInfoByVal, Index - 1);
+    FindSymInfoByValue (&Info->LabelInfoByVal, S->Value, &Index);
+    return CollAt (&Info->LabelInfoByVal, Index);
+}
+
+
+
+static void ProcessCSymInfo (InputData* D)
+/* Postprocess c symbol infos */
+{
+    unsigned I;
+
+    /* Walk over all c symbols. Resolve the ids and add the c symbols to the
+    ** corresponding asm symbols.
+    */
+    for (I = 0; I < CollCount (&D->Info->CSymInfoById); ++I) {
+
+        /* Get this c symbol info */
+        CSymInfo* S = CollAt (&D->Info->CSymInfoById, I);
+
+        /* Resolve the asm symbol */
+        if (S->Sym.Id == CC65_INV_ID || !(D->Records & CC65_RECORD_SYM)) {
+            S->Sym.Info = 0;
+        } else if (S->Sym.Id >= CollCount (&D->Info->SymInfoById)) {
+            ParseError (D,
+                        CC65_ERROR,
+                        "Invalid symbol id %u for c symbol with id %u",
+                        S->Sym.Id, S->Id);
+            S->Sym.Info = 0;
+        } else {
+            S->Sym.Info = CollAt (&D->Info->SymInfoById, S->Sym.Id);
+
+            /* For normal (=static) symbols, add a backlink to the symbol but
+            ** check that there is not more than one.
+            */
+            if (S->SC != CC65_CSYM_AUTO && S->SC != CC65_CSYM_REG) {
+                if (S->Sym.Info->CSym) {
+                    ParseError (D,
+                                CC65_ERROR,
+                                "Asm symbol id %u has more than one C symbol attached",
+                                S->Sym.Info->Id);
+                    S->Sym.Info = 0;
+                } else {
+                    S->Sym.Info->CSym = S;
+                }
+            }
+        }
+
+        /* Resolve the type */
+        if (!(D->Records & CC65_RECORD_TYPE)) {
+            S->Type.Info = 0;
+        } else if (S->Type.Id >= CollCount (&D->Info->TypeInfoById)) {
+            ParseError (D,
+                        CC65_ERROR,
+                        "Invalid type id %u for c symbol with id %u",
+                        S->Type.Id, S->Id);
+            S->Type.Info = 0;
+        } else {
+            S->Type.Info = CollAt (&D->Info->TypeInfoById, S->Type.Id);
+        }
+
+        /* Resolve the scope */
+        if (!(D->Records & CC65_RECORD_SCOPE)) {
+            S->Scope.Info = 0;
+        } else if (S->Scope.Id >= CollCount (&D->Info->ScopeInfoById)) {
+            ParseError (D,
+                        CC65_ERROR,
+                        "Invalid scope id %u for c symbol with id %u",
+                        S->Scope.Id, S->Id);
+            S->Scope.Info = 0;
+        } else {
+            S->Scope.Info = CollAt (&D->Info->ScopeInfoById, S->Scope.Id);
+
+            /* Add the c symbol to the list of all c symbols for this scope */
+            if (S->Scope.Info->CSymInfoByName == 0) {
+                S->Scope.Info->CSymInfoByName = CollNew (D->Info->Mem);
+            }
+            CollAppend (S->Scope.Info->CSymInfoByName, S);
+
+            /* If the scope has an owner symbol, it's a .PROC scope. If this
+            ** symbol is identical to the one attached to the C symbol, this
+            ** is actuallay a C function and the scope is the matching scope.
+            ** Remember the C symbol in the scope in this case.
+            ** Beware: Scopes haven't been postprocessed, so we don't have a
+            ** pointer but just an id.
+            */
+            if (S->Sym.Info && S->Scope.Info->Label.Id == S->Sym.Info->Id) {
+                /* This scope is our function scope */
+                S->Scope.Info->CSymFunc = S;
+                /* Add it to the list of all c functions */
+                CollAppend (&D->Info->CSymFuncByName, S);
+            }
+
+        }
+    }
+
+    /* Walk over all scopes and sort the c symbols by name. */
+    for (I = 0; I < CollCount (&D->Info->ScopeInfoById); ++I) {
+
+        /* Get this scope */
+        ScopeInfo* S = CollAt (&D->Info->ScopeInfoById, I);
+
+        /* Ignore scopes without C symbols */
+        if (CollCount (S->CSymInfoByName) > 1) {
+            /* Sort the c symbols for this scope by name */
+            QueueSort (D, S->CSymInfoByName, CompareCSymInfoByName);
+        }
+    }
+
+    /* Sort the main list of all C functions by name */
+    QueueSort (D, &D->Info->CSymFuncByName, CompareCSymInfoByName);
+}
+
+
+
+static void ProcessFileInfo (InputData* D)
+/* Postprocess file infos */
+{
+    /* Walk over all file infos and resolve the module ids */
+    unsigned I;
+    for (I = 0; I < CollCount (&D->Info->FileInfoById); ++I) {
+
+        /* Get this file info */
+        FileInfo* F = CollAt (&D->Info->FileInfoById, I);
+
+        /* Resolve the module ids */
+        unsigned J;
+        if (!(D->Records & CC65_RECORD_MOD)) {
+            CollDeleteAll (&F->ModInfoByName);
+        }
+        for (J = 0; J < CollCount (&F->ModInfoByName); ++J) {
+
+            /* Get the id of this module */
+            unsigned ModId = CollIdAt (&F->ModInfoByName, J);
+            if (ModId >= CollCount (&D->Info->ModInfoById)) {
+                ParseError (D,
+                            CC65_ERROR,
+                            "Invalid module id %u for file with id %u",
+                            ModId, F->Id);
+                CollReplace (&F->ModInfoByName, 0, J);
+            } else {
+
+                /* Get a pointer to the module */
+                ModInfo* M = CollAt (&D->Info->ModInfoById, ModId);
+
+                /* Replace the id by the pointer */
+                CollReplace (&F->ModInfoByName, M, J);
+
+                /* Insert a backpointer into the module */
+                CollAppend (&M->FileInfoByName, F);
+            }
+        }
+
+        /* If we didn't have any errors, sort the modules by name */
+        if (D->Errors == 0) {
+            QueueSort (D, &F->ModInfoByName, CompareModInfoByName);
+        }
+    }
+
+    /* Now walk over all modules and sort the file infos by name */
+    for (I = 0; I < CollCount (&D->Info->ModInfoById); ++I) {
+
+        /* Get this module info */
+        ModInfo* M = CollAt (&D->Info->ModInfoById, I);
+
+        /* Sort the files by name */
+        QueueSort (D, &M->FileInfoByName, CompareFileInfoByName);
     }
 
     /* Sort the file infos by name, so we can do a binary search */
-    CollSort (&D->Info->FileInfoByName, CompareFileInfoByName);
+    QueueSort (D, &D->Info->FileInfoByName, CompareFileInfoByName);
 }
 
 
@@ -5137,6 +6900,9 @@ static void ProcessLineInfo (InputData* D)
         }
 
         /* Resolve the spans ids */
+        if (!(D->Records & CC65_RECORD_SPAN)) {
+            CollDeleteAll (&L->SpanInfoList);
+        }
         for (J = 0; J < CollCount (&L->SpanInfoList); ++J) {
 
             /* Get the id of this span */
@@ -5157,7 +6923,7 @@ static void ProcessLineInfo (InputData* D)
 
                 /* Insert a backpointer into the span */
                 if (SP->LineInfoList == 0) {
-                    SP->LineInfoList = CollNew ();
+                    SP->LineInfoList = CollNew (D->Info->Mem);
                 }
                 CollAppend (SP->LineInfoList, L);
             }
@@ -5173,7 +6939,7 @@ static void ProcessLineInfo (InputData* D)
         FileInfo* F = CollAt (FileInfos, I);
 
         /* Sort the line infos for this file */
-        CollSort (&F->LineInfoByLine, CompareLineInfoByLine);
+        DeferSort (D, INDEX_LINES, &F->LineInfoByLine, CompareLineInfoByLine);
     }
 }
 
@@ -5202,7 +6968,7 @@ static void ProcessModInfo (InputData* D)
         }
 
         /* Resolve the library */
-        if (M->Lib.Id == CC65_INV_ID) {
+        if (M->Lib.Id == CC65_INV_ID || !(D->Records & CC65_RECORD_LIB)) {
             M->Lib.Info = 0;
         } else if (M->Lib.Id >= CollCount (&D->Info->LibInfoById)) {
             ParseError (D,
@@ -5216,7 +6982,7 @@ static void ProcessModInfo (InputData* D)
     }
 
     /* Sort the collection that contains the module info by name */
-    CollSort (&D->Info->ModInfoByName, CompareModInfoByName);
+    QueueSort (D, &D->Info->ModInfoByName, CompareModInfoByName);
 }
 
 
@@ -5277,13 +7043,13 @@ static void ProcessScopeInfo (InputData* D)
 
             /* Set a backpointer in the parent */
             if (S->Parent.Info->ChildScopeList == 0) {
-                S->Parent.Info->ChildScopeList = CollNew ();
+                S->Parent.Info->ChildScopeList = CollNew (D->Info->Mem);
             }
             CollAppend (S->Parent.Info->ChildScopeList, S);
         }
 
         /* Resolve the label */
-        if (S->Label.Id == CC65_INV_ID) {
+        if (S->Label.Id == CC65_INV_ID || !(D->Records & CC65_RECORD_SYM)) {
             S->Label.Info = 0;
         } else if (S->Label.Id >= CollCount (&D->Info->SymInfoById)) {
             ParseError (D,
@@ -5296,6 +7062,9 @@ static void ProcessScopeInfo (InputData* D)
         }
 
         /* Resolve the spans ids */
+        if (!(D->Records & CC65_RECORD_SPAN)) {
+            CollDeleteAll (&S->SpanInfoList);
+        }
         for (J = 0; J < CollCount (&S->SpanInfoList); ++J) {
 
             /* Get the id of this span */
@@ -5316,7 +7085,7 @@ static void ProcessScopeInfo (InputData* D)
 
                 /* Insert a backpointer into the span */
                 if (SP->ScopeInfoList == 0) {
-                    SP->ScopeInfoList = CollNew ();
+                    SP->ScopeInfoList = CollNew (D->Info->Mem);
                 }
                 CollAppend (SP->ScopeInfoList, S);
             }
@@ -5347,14 +7116,16 @@ static void ProcessScopeInfo (InputData* D)
         }
 
         /* Sort the scopes for this module by name */
-        CollSort (&M->ScopeInfoByName, CompareScopeInfoByName);
+        DeferSort (D, INDEX_SCOPES, &M->ScopeInfoByName,
+                   CompareScopeInfoByName);
 
         /* Sort the C functions in this module by name */
-        CollSort (&M->CSymFuncByName, CompareCSymInfoByName);
+        QueueSort (D, &M->CSymFuncByName, CompareCSymInfoByName);
     }
 
     /* Sort the scope infos */
-    CollSort (&D->Info->ScopeInfoByName, CompareScopeInfoByName);
+    DeferSort (D, INDEX_SCOPES, &D->Info->ScopeInfoByName,
+               CompareScopeInfoByName);
 }
 
 
@@ -5362,8 +7133,9 @@ static void ProcessScopeInfo (InputData* D)
 static void ProcessSegInfo (InputData* D)
 /* Postprocess segment infos */
 {
-    /* Sort the segment infos by name */
-    CollSort (&D->Info->SegInfoByName, CompareSegInfoByName);
+    /* Sort the segment infos by name and by address */
+    QueueSort (D, &D->Info->SegInfoByName, CompareSegInfoByName);
+    QueueSort (D, &D->Info->SegInfoByAddr, CompareSegInfoByAddr);
 }
 
 
@@ -5373,12 +7145,6 @@ static void ProcessSpanInfo (InputData* D)
 {
     unsigned I;
 
-    /* Temporary collection with span infos sorted by address */
-    Collection SpanInfoByAddr = COLLECTION_INITIALIZER;
-
-    /* Resize the temporary collection */
-    CollGrow (&SpanInfoByAddr, CollCount (&D->Info->SpanInfoById));
-
     /* Walk over all spans and resolve the ids */
     for (I = 0; I < CollCount (&D->Info->SpanInfoById); ++I) {
 
@@ -5399,7 +7165,7 @@ static void ProcessSpanInfo (InputData* D)
         }
 
         /* Resolve the type if we have it */
-        if (S->Type.Id == CC65_INV_ID) {
+        if (S->Type.Id == CC65_INV_ID || !(D->Records & CC65_RECORD_TYPE)) {
             S->Type.Info = 0;
         } else if (S->Type.Id >= CollCount (&D->Info->TypeInfoById)) {
             ParseError (D,
@@ -5410,21 +7176,10 @@ static void ProcessSpanInfo (InputData* D)
         } else {
             S->Type.Info = CollAt (&D->Info->TypeInfoById, S->Type.Id);
         }
-
-        /* Append this span info to the temporary collection that is later
-        ** sorted by address.
-        */
-        CollAppend (&SpanInfoByAddr, S);
     }
 
-    /* Sort the collection with all span infos by address */
-    CollSort (&SpanInfoByAddr, CompareSpanInfoByAddr);
-
-    /* Create the span info list from the span info collection */
-    CreateSpanInfoList (&D->Info->SpanInfoByAddr, &SpanInfoByAddr);
-
-    /* Remove the temporary collection */
-    CollDone (&SpanInfoByAddr);
+    /* The spans are indexed by address when they're needed the first time */
+    D->Info->SpanMap.Budget = D->AddrMapBudget;
 }
 
 
@@ -5454,13 +7209,13 @@ static void ProcessSymInfo (InputData* D)
 
             /* Add a backpointer, so the export knows its imports */
             if (S->Exp.Info->ImportList == 0) {
-                S->Exp.Info->ImportList = CollNew ();
+                S->Exp.Info->ImportList = CollNew (D->Info->Mem);
             }
             CollAppend (S->Exp.Info->ImportList, S);
         }
 
         /* Resolve segment */
-        if (S->Seg.Id == CC65_INV_ID) {
+        if (S->Seg.Id == CC65_INV_ID || !(D->Records & CC65_RECORD_SEG)) {
             S->Seg.Info = 0;
         } else if (S->Seg.Id >= CollCount (&D->Info->SegInfoById)) {
             ParseError (D,
@@ -5500,93 +7255,483 @@ static void ProcessSymInfo (InputData* D)
         } else {
             S->Parent.Info = CollAt (&D->Info->SymInfoById, S->Parent.Id);
 
-            /* Place a backpointer to the cheap local into the parent */
-            if (S->Parent.Info->CheapLocals == 0) {
-                S->Parent.Info->CheapLocals = CollNew ();
-            }
-            CollAppend (S->Parent.Info->CheapLocals, S);
+            /* Place a backpointer to the cheap local into the parent */
+            if (S->Parent.Info->CheapLocals == 0) {
+                S->Parent.Info->CheapLocals = CollNew (D->Info->Mem);
+            }
+            CollAppend (S->Parent.Info->CheapLocals, S);
+        }
+
+        /* Resolve the line infos for the symbol definition */
+        if (!(D->Records & CC65_RECORD_LINE)) {
+            CollDeleteAll (&S->DefLineInfoList);
+            CollDeleteAll (&S->RefLineInfoList);
+        }
+        for (J = 0; J < CollCount (&S->DefLineInfoList); ++J) {
+
+            /* Get the id of this line info */
+            unsigned LineId = CollIdAt (&S->DefLineInfoList, J);
+            if (LineId >= CollCount (&D->Info->LineInfoById)) {
+                ParseError (D,
+                            CC65_ERROR,
+                            "Invalid line id %u for symbol with id %u",
+                            LineId, S->Id);
+                CollReplace (&S->DefLineInfoList, 0, J);
+            } else {
+                /* Get a pointer to the line info */
+                LineInfo* LI = CollAt (&D->Info->LineInfoById, LineId);
+
+                /* Replace the id by the pointer */
+                CollReplace (&S->DefLineInfoList, LI, J);
+            }
+        }
+
+        /* Resolve the line infos for symbol references */
+        for (J = 0; J < CollCount (&S->RefLineInfoList); ++J) {
+
+            /* Get the id of this line info */
+            unsigned LineId = CollIdAt (&S->RefLineInfoList, J);
+            if (LineId >= CollCount (&D->Info->LineInfoById)) {
+                ParseError (D,
+                            CC65_ERROR,
+                            "Invalid line id %u for symbol with id %u",
+                            LineId, S->Id);
+                CollReplace (&S->RefLineInfoList, 0, J);
+            } else {
+                /* Get a pointer to the line info */
+                LineInfo* LI = CollAt (&D->Info->LineInfoById, LineId);
+
+                /* Replace the id by the pointer */
+                CollReplace (&S->RefLineInfoList, LI, J);
+            }
+        }
+
+    }
+
+    /* Second run. Resolve scopes for cheap locals */
+    for (I = 0; I < CollCount (&D->Info->SymInfoById); ++I) {
+
+        /* Get the symbol info */
+        SymInfo* S = CollAt (&D->Info->SymInfoById, I);
+
+        /* Resolve the scope */
+        if (S->Scope.Info == 0) {
+            /* No scope - must have a parent */
+            if (S->Parent.Info == 0) {
+                ParseError (D,
+                            CC65_ERROR,
+                            "Symbol with id %u has no parent and no scope",
+                            S->Id);
+            } else if (S->Parent.Info->Scope.Info == 0) {
+                ParseError (D,
+                            CC65_ERROR,
+                            "Symbol with id %u has parent %u without a scope",
+                            S->Id, S->Parent.Info->Id);
+            } else {
+                S->Scope.Info = S->Parent.Info->Scope.Info;
+            }
+        }
+    }
+
+    /* Walk over the scopes and sort the symbols in the scope by name */
+    for (I = 0; I < CollCount (&D->Info->ScopeInfoById); ++I) {
+
+        /* Get the scope info */
+        ScopeInfo* S = CollAt (&D->Info->ScopeInfoById, I);
+
+        /* Sort the symbols in this scope by name */
+        DeferSort (D, INDEX_SYMBOLS, &S->SymInfoByName, CompareSymInfoByName);
+    }
+
+    /* Sort the symbol infos */
+    DeferSort (D, INDEX_SYMBOLS, &D->Info->SymInfoByName,
+               CompareSymInfoByName);
+    DeferKeySort (D, INDEX_SYMVALS, &D->Info->SymInfoByVal, SortSymInfoByVal);
+}
+
+
+
+static void IndexNames (InputData* D)
+/* Create the hash indexes for the collections sorted by name that aren't
+** part of a secondary index. Must be called after the collections have been
+** sorted.
+*/
+{
+    DbgInfo* Info = D->Info;
+
+    CreateNameIndex (&Info->CSymFuncIndex, &Info->CSymFuncByName,
+                     offsetof (CSymInfo, Name));
+    CreateNameIndex (&Info->SegIndex, &Info->SegInfoByName,
+                     offsetof (SegInfo, Name));
+}
+
+
+
+static void IndexSegs (DbgInfo* Info)
+/* Store the highest end address of all segments up to each one in the
+** segment infos sorted by address, so searches can stop at gaps. Must be
+** called after the collection has been sorted.
+*/
+{
+    unsigned long MaxEnd = 0;
+    unsigned      I;
+
+    for (I = 0; I < CollCount (&Info->SegInfoByAddr); ++I) {
+        SegInfo* S = CollAt (&Info->SegInfoByAddr, I);
+        unsigned long End = (unsigned long) S->Start + S->Size;
+        if (End > MaxEnd) {
+            MaxEnd = End;
+        }
+        S->MaxEnd = MaxEnd;
+    }
+}
+
+
+
+static void IndexLabels (DbgInfo* Info)
+/* Collect the labels from the symbols sorted by value, so that the labels in
+** a range are contiguous.
+*/
+{
+    unsigned I;
+    for (I = 0; I < CollCount (&Info->SymInfoByVal); ++I) {
+        SymInfo* S = CollAt (&Info->SymInfoByVal, I);
+        if (S->Type == CC65_SYM_LABEL) {
+            CollAppend (&Info->LabelInfoByVal, S);
+        }
+    }
+}
+
+
+
+static void MarkIndex (DbgInfo* Info, IndexKind Index)
+/* Mark a secondary index as built. Must be called with the lock held. */
+{
+#if HAVE_ATOMICS
+    __atomic_store_n (&Info->Built, Info->Built | (1U << Index), __ATOMIC_RELEASE);
+#else
+    Info->Built |= (1U << Index);
+#endif
+}
+
+
+
+static void BuildIndex (DbgInfo* Info, IndexKind Index)
+/* Build a secondary index by running its pending sorts. Must be called with
+** the lock held.
+*/
+{
+    RunSorts (&Info->Sorts[Index]);
+    switch (Index) {
+
+        case INDEX_SCOPES:
+            CreateNameIndex (&Info->ScopeIndex, &Info->ScopeInfoByName,
+                             offsetof (ScopeInfo, Name));
+            break;
+
+        case INDEX_SPANS:
+            /* The span info list is created from the sorted spans */
+            if ((Info->Built & (1U << INDEX_SPANORDER)) == 0) {
+                BuildIndex (Info, INDEX_SPANORDER);
+                MarkIndex (Info, INDEX_SPANORDER);
+            }
+            IndexSpans (Info);
+            break;
+
+        case INDEX_SPANORDER:
+            SortSpans (Info);
+            break;
+
+        case INDEX_SYMBOLS:
+            CreateNameIndex (&Info->SymIndex, &Info->SymInfoByName,
+                             offsetof (SymInfo, Name));
+            break;
+
+        case INDEX_SYMVALS:
+            IndexLabels (Info);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+
+static void NeedIndex (const DbgInfo* Info, IndexKind Index)
+/* Make sure a secondary index has been built. Indexes are built by the first
+** query that needs them, which may run on several threads at the same time.
+*/
+{
+    /* The index is built in place, so we have to cast away the const */
+    DbgInfo* I    = (DbgInfo*) Info;
+    unsigned Mask = 1U << Index;
+
+#if HAVE_ATOMICS
+    /* Once an index exists, there's no need to lock */
+    if (__atomic_load_n (&I->Built, __ATOMIC_ACQUIRE) & Mask) {
+        return;
+    }
+#endif
+
+#if HAVE_THREADS
+    pthread_mutex_lock (&I->Lock);
+#endif
+    if ((I->Built & Mask) == 0) {
+        BuildIndex (I, Index);
+        MarkIndex (I, Index);
+    }
+#if HAVE_THREADS
+    pthread_mutex_unlock (&I->Lock);
+#endif
+}
+
+
+
+static unsigned SpanId (const SpanInfo* S)
+/* Return the id of a span for FindIdsByAddr */
+{
+    return S->Id;
+}
+
+
+
+static unsigned SpanLineId (const SpanInfo* S)
+/* Return the id of the first line of a span for FindIdsByAddr */
+{
+    if (S->LineInfoList && CollCount (S->LineInfoList) > 0) {
+        return ((const LineInfo*) CollAt (S->LineInfoList, 0))->Id;
+    }
+    return CC65_INV_ID;
+}
+
+
+
+static unsigned SpanScopeId (const SpanInfo* S)
+/* Return the id of the first scope of a span for FindIdsByAddr */
+{
+    if (S->ScopeInfoList && CollCount (S->ScopeInfoList) > 0) {
+        return ((const ScopeInfo*) CollAt (S->ScopeInfoList, 0))->Id;
+    }
+    return CC65_INV_ID;
+}
+
+
+
+static int IsInnerSpan (const SpanInfo* S, const SpanInfo* Best)
+/* Return true if S is nested deeper than Best, or Best is NULL. Of two
+** spans that cover an address, the smaller one is nested deeper. Spans of
+** the same size are ordered by id.
+*/
+{
+    cc65_addr SSize, BSize;
+    if (Best == 0) {
+        return 1;
+    }
+    SSize = S->End - S->Start;
+    BSize = Best->End - Best->Start;
+    return SSize < BSize || (SSize == BSize && S->Id < Best->Id);
+}
+
+
+
+static void SortAddrs (Collection* Queries, const cc65_addr* Addrs,
+                       unsigned Count)
+/* Fill Queries with pointers to the Count addresses in Addrs, sorted by
+** address, so batch lookups can merge them with an index.
+*/
+{
+    CollKey* Keys = xmalloc (Count * sizeof (CollKey));
+    unsigned I;
+
+    CollGrow (Queries, Count);
+    for (I = 0; I < Count; ++I) {
+        Keys[I].Hi  = 0;
+        Keys[I].Lo  = Addrs[I];
+        Keys[I].Ptr = (void*) (Addrs + I);
+        CollAppend (Queries, Keys[I].Ptr);
+    }
+    CollSortByKey (Queries, Keys);
+    xfree (Keys);
+}
+
+
+
+static const SpanInfo* InnermostSpan (const SpanInfo** Spans, unsigned Count,
+                                      unsigned (*GetId) (const SpanInfo*))
+/* Return the innermost of the given spans for which GetId doesn't return
+** CC65_INV_ID, or NULL if there is none.
+*/
+{
+    const SpanInfo* Best = 0;
+    unsigned I;
+    for (I = 0; I < Count; ++I) {
+        if (GetId (Spans[I]) != CC65_INV_ID && IsInnerSpan (Spans[I], Best)) {
+            Best = Spans[I];
         }
+    }
+    return Best;
+}
 
-        /* Resolve the line infos for the symbol definition */
-        for (J = 0; J < CollCount (&S->DefLineInfoList); ++J) {
 
-            /* Get the id of this line info */
-            unsigned LineId = CollIdAt (&S->DefLineInfoList, J);
-            if (LineId >= CollCount (&D->Info->LineInfoById)) {
-                ParseError (D,
-                            CC65_ERROR,
-                            "Invalid line id %u for symbol with id %u",
-                            LineId, S->Id);
-                CollReplace (&S->DefLineInfoList, 0, J);
-            } else {
-                /* Get a pointer to the line info */
-                LineInfo* LI = CollAt (&D->Info->LineInfoById, LineId);
 
-                /* Replace the id by the pointer */
-                CollReplace (&S->DefLineInfoList, LI, J);
+static unsigned FindIdsByAddr (const DbgInfo* Info, const cc65_addr* Addrs,
+                               unsigned Count, unsigned* Ids,
+                               unsigned (*GetId) (const SpanInfo*))
+/* Look up many addresses at once. For each address, store the id GetId
+** returns for the innermost span that covers the address and for which
+** GetId doesn't return CC65_INV_ID. Return the number of addresses found.
+** A few addresses, or any number with a small address map, are looked up
+** one by one. Otherwise it's faster to sort the addresses, and to sweep over
+** the spans in order of their start address while keeping a list of the
+** spans that cover the current address.
+*/
+{
+    const SpanInfoList* L = &Info->SpanInfoByAddr;
+    const AddrMap*      M;
+    Collection          Queries = COLLECTION_INITIALIZER;
+    Collection          Active  = COLLECTION_INITIALIZER;
+    unsigned            Found = 0;
+    unsigned            Next  = 0;
+    unsigned            LastId = CC65_INV_ID;
+    unsigned            I, J, K;
+
+    /* Make sure the spans are indexed by address */
+    NeedIndex (Info, INDEX_SPANS);
+    M = GetSpanMap (Info);
+
+    /* Look up the addresses one by one if that's faster */
+    if ((M && M->Size <= ADDRMAP_CACHED) || Count < L->Count / 4) {
+        const SpanInfo** Buf     = 0;
+        unsigned         BufSize = 0;
+        for (I = 0; I < Count; ++I) {
+            const SpanInfo** Spans;
+            const SpanInfo*  Best;
+            unsigned         N;
+            if (M) {
+                Spans = FindSpansInAddrMap (M, Addrs[I], &N);
+            } else {
+                N = FindSpanInfoByAddr (L, Addrs[I], 0, 0);
+                if (N > BufSize) {
+                    xfree (Buf);
+                    BufSize = N;
+                    Buf = xmalloc (BufSize * sizeof (Buf[0]));
+                }
+                FindSpanInfoByAddr (L, Addrs[I], 0, Buf);
+                Spans = Buf;
             }
+            Best   = InnermostSpan (Spans, N, GetId);
+            Ids[I] = Best? GetId (Best) : CC65_INV_ID;
+            Found += (Best != 0);
         }
+        xfree (Buf);
+        return Found;
+    }
 
-        /* Resolve the line infos for symbol references */
-        for (J = 0; J < CollCount (&S->RefLineInfoList); ++J) {
+    /* Sweep over the sorted addresses */
+    SortAddrs (&Queries, Addrs, Count);
+    for (I = 0; I < Count; ++I) {
 
-            /* Get the id of this line info */
-            unsigned LineId = CollIdAt (&S->RefLineInfoList, J);
-            if (LineId >= CollCount (&D->Info->LineInfoById)) {
-                ParseError (D,
-                            CC65_ERROR,
-                            "Invalid line id %u for symbol with id %u",
-                            LineId, S->Id);
-                CollReplace (&S->RefLineInfoList, 0, J);
-            } else {
-                /* Get a pointer to the line info */
-                LineInfo* LI = CollAt (&D->Info->LineInfoById, LineId);
+        const cc65_addr* A = CollAt (&Queries, I);
 
-                /* Replace the id by the pointer */
-                CollReplace (&S->RefLineInfoList, LI, J);
+        /* Addresses that occur more than once are looked up once */
+        if (I == 0 || *A != *(const cc65_addr*) CollAt (&Queries, I - 1)) {
+
+            const SpanInfo* Best = 0;
+
+            /* Add the spans that start up to this address */
+            while (Next < L->Count && L->List[Next].Start <= *A) {
+                CollAppend (&Active, L->List[Next++].Span);
+            }
+
+            /* Remove the spans that end before it, and find the innermost
+            ** of the remaining ones.
+            */
+            for (J = 0, K = 0; J < CollCount (&Active); ++J) {
+                const SpanInfo* S = CollAt (&Active, J);
+                if (S->End >= *A) {
+                    CollReplace (&Active, (void*) S, K++);
+                    if (GetId (S) != CC65_INV_ID && IsInnerSpan (S, Best)) {
+                        Best = S;
+                    }
+                }
             }
+            Active.Count = K;
+            LastId = Best? GetId (Best) : CC65_INV_ID;
         }
 
+        Ids[A - Addrs] = LastId;
+        Found += (LastId != CC65_INV_ID);
     }
 
-    /* Second run. Resolve scopes for cheap locals */
-    for (I = 0; I < CollCount (&D->Info->SymInfoById); ++I) {
+    /* Free the temporary collections */
+    CollDone (&Queries);
+    CollDone (&Active);
+    return Found;
+}
 
-        /* Get the symbol info */
-        SymInfo* S = CollAt (&D->Info->SymInfoById, I);
 
-        /* Resolve the scope */
-        if (S->Scope.Info == 0) {
-            /* No scope - must have a parent */
-            if (S->Parent.Info == 0) {
-                ParseError (D,
-                            CC65_ERROR,
-                            "Symbol with id %u has no parent and no scope",
-                            S->Id);
-            } else if (S->Parent.Info->Scope.Info == 0) {
-                ParseError (D,
-                            CC65_ERROR,
-                            "Symbol with id %u has parent %u without a scope",
-                            S->Id, S->Parent.Info->Id);
-            } else {
-                S->Scope.Info = S->Parent.Info->Scope.Info;
+
+static unsigned FindLabelsByAddr (const DbgInfo* Info, const cc65_addr* Addrs,
+                                  unsigned Count, unsigned* Ids,
+                                  cc65_addr* Offsets)
+/* Look up the nearest label at or below each of Count addresses, as
+** FindLabelBelow does. Store the ids of the labels and, if Offsets isn't
+** NULL, the offsets of the addresses from them. Return the number of
+** addresses found. Many addresses are sorted and merged with the labels.
+*/
+{
+    const Collection* Labels = &Info->LabelInfoByVal;
+    Collection        Queries = COLLECTION_INITIALIZER;
+    const SymInfo*    S     = 0;
+    unsigned          Found = 0;
+    unsigned          Next  = 0;
+    unsigned          I;
+
+    /* Make sure the labels are sorted by value */
+    NeedIndex (Info, INDEX_SYMVALS);
+
+    /* Few addresses are looked up one by one */
+    if (Count < CollCount (Labels) / 4) {
+        for (I = 0; I < Count; ++I) {
+            S = FindLabelBelow (Info, Addrs[I]);
+            Ids[I] = S? S->Id : CC65_INV_ID;
+            if (Offsets) {
+                Offsets[I] = S? Addrs[I] - (cc65_addr) S->Value : 0;
             }
+            Found += (S != 0);
         }
+        return Found;
     }
 
-    /* Walk over the scopes and sort the symbols in the scope by name */
-    for (I = 0; I < CollCount (&D->Info->ScopeInfoById); ++I) {
-
-        /* Get the scope info */
-        ScopeInfo* S = CollAt (&D->Info->ScopeInfoById, I);
-
-        /* Sort the symbols in this scope by name */
-        CollSort (&S->SymInfoByName, CompareSymInfoByName);
+    /* Sweep over the sorted addresses. Next is the first label above the
+    ** current address, S the first label with the value of the one before
+    ** Next.
+    */
+    SortAddrs (&Queries, Addrs, Count);
+    for (I = 0; I < Count; ++I) {
+        const cc65_addr* A = CollAt (&Queries, I);
+        unsigned         K = A - Addrs;
+        while (Next < CollCount (Labels)) {
+            const SymInfo* L = CollAt (Labels, Next);
+            if (L->Value > (long) *A) {
+                break;
+            }
+            if (S == 0 || L->Value != S->Value) {
+                S = L;
+            }
+            ++Next;
+        }
+        Ids[K] = S? S->Id : CC65_INV_ID;
+        if (Offsets) {
+            Offsets[K] = S? *A - (cc65_addr) S->Value : 0;
+        }
+        Found += (S != 0);
     }
 
-    /* Sort the symbol infos */
-    CollSort (&D->Info->SymInfoByName, CompareSymInfoByName);
-    CollSort (&D->Info->SymInfoByVal,  CompareSymInfoByVal);
+    /* Free the sorted addresses */
+    CollDone (&Queries);
+    return Found;
 }
 
 
@@ -5597,36 +7742,319 @@ static void ProcessSymInfo (InputData* D)
 
 
 
-cc65_dbginfo cc65_read_dbginfo (const char* FileName, cc65_errorfunc ErrFunc)
-/* Parse the debug info file with the given name. On success, the function
-** will return a pointer to an opaque cc65_dbginfo structure, that must be
-** passed to the other functions in this module to retrieve information.
-** errorfunc is called in case of warnings and errors. If the file cannot be
-** read successfully, NULL is returned.
+static int OpenInput (InputData* D)
+/* Open the input file. Regular files are mapped into memory and scanned as
+** one contiguous buffer, everything else is read line by line through stdio.
+** Return true on success. On failure, errno contains the reason.
 */
 {
-    /* Data structure used to control scanning and parsing */
-    InputData D = {
+#if HAVE_MMAP
+    struct stat S;
+    int         Error;
+    int         FD;
+#endif
+
+    /* Start with an empty buffer, stdio input will fill it on demand */
+    D->Buf = D->Pos = D->End = D->LineStart = "";
+
+#if HAVE_MMAP
+    FD = open (D->FileName, O_RDONLY);
+    if (FD < 0) {
+        return 0;
+    }
+    if (fstat (FD, &S) == 0 && S_ISREG (S.st_mode) &&
+        (off_t) (size_t) S.st_size == S.st_size) {
+
+        void* M = 0;
+        if (S.st_size == 0) {
+            /* mmap refuses empty mappings, but an empty buffer does it */
+            close (FD);
+            return 1;
+        }
+        M = mmap (0, S.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+        if (M != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            madvise (M, S.st_size, MADV_SEQUENTIAL);
+#endif
+            close (FD);
+            D->MapSize = S.st_size;
+            D->Buf     = D->Pos = D->LineStart = M;
+            D->End     = D->Buf + D->MapSize;
+            return 1;
+        }
+    }
+
+    /* Not a regular file or cannot map it, so use stdio */
+    D->F = fdopen (FD, "r");
+    if (D->F == 0) {
+        Error = errno;
+        close (FD);
+        errno = Error;
+        return 0;
+    }
+    return 1;
+#else
+    D->F = fopen (D->FileName, "rt");
+    return (D->F != 0);
+#endif
+}
+
+
+
+static void CloseInput (InputData* D)
+/* Close the input file */
+{
+#if HAVE_MMAP
+    if (D->MapSize) {
+        munmap ((void*) D->Buf, D->MapSize);
+    }
+#endif
+    if (D->F) {
+        fclose (D->F);
+    }
+}
+
+
+
+static unsigned RecordClosure (unsigned Records)
+/* Add the record kinds to Records that the ones in Records cannot do
+** without. Other references between records are optional and left
+** unresolved if the referenced kind is not loaded.
+*/
+{
+    if (Records & CC65_RECORD_SYM) {
+        /* Symbols without a scope are an error */
+        Records |= CC65_RECORD_SCOPE;
+    }
+    if (Records & CC65_RECORD_SCOPE) {
+        Records |= CC65_RECORD_MOD;
+    }
+    if (Records & (CC65_RECORD_LINE | CC65_RECORD_MOD)) {
+        Records |= CC65_RECORD_FILE;
+    }
+    if (Records & CC65_RECORD_SPAN) {
+        /* Spans are relocated by their segment */
+        Records |= CC65_RECORD_SEG;
+    }
+    return Records & CC65_RECORD_ALL;
+}
+
+
+
+static void InitInputData (InputData* D, const char* FileName,
+                           const cc65_dbgoptions* Options,
+                           cc65_errorfunc ErrFunc)
+/* Initialize the scanner and parser state for the given input */
+{
+    /* Initial state of the scanner and parser */
+    static const InputData Init = {
         0,                      /* Name of input file */
         1,                      /* Line number */
-        0,                      /* Input file */
         0,                      /* Line at start of current token */
         0,                      /* Column at start of current token */
         0,                      /* Number of errors */
         0,                      /* Input file */
+        STRBUF_INITIALIZER,     /* Line buffer */
+        0,                      /* Input buffer */
+        0,                      /* Next character in buffer */
+        0,                      /* End of buffer */
+        0,                      /* Start of line in buffer */
+        0,                      /* Size of mapping */
+        0,                      /* Classified block */
+        0,                      /* Delimiters in block */
+        0,                      /* Quotes and newlines in block */
         ' ',                    /* Input character */
         TOK_INVALID,            /* Input token */
         0,                      /* Integer constant */
-        STRBUF_INITIALIZER,     /* String constant */
+        STRREF_INITIALIZER,     /* Identifier or string constant */
         0,                      /* Function called in case of errors */
+        0,                      /* Deferred errors */
+        COLLECTION_INITIALIZER, /* Sorts to run after processing */
+        CC65_RECORD_ALL,        /* Record kinds to load */
+        ADDRMAP_BUDGET,         /* Memory for address table */
         0,                      /* Pointer to debug info */
     };
-    D.FileName = FileName;
-    D.Error    = ErrFunc;
+    *D = Init;
+    D->FileName = FileName;
+    D->Error    = ErrFunc;
+
+    /* Load the requested record kinds, and the ones they depend on */
+    if (Options && Options->records != 0) {
+        D->Records = RecordClosure (Options->records);
+    }
+    if (Options && Options->addrmap_budget != 0) {
+        D->AddrMapBudget = Options->addrmap_budget;
+    }
+}
+
+
+
+static int ParseHeader (InputData* D)
+/* Parse and check the version line at the start of the input. The current
+** token must be the first one in the input. Return false if the remainder
+** of the input cannot be parsed.
+*/
+{
+    /* The first line in the file must specify version information */
+    if (D->Tok != TOK_VERSION) {
+        ParseError (D, CC65_ERROR,
+                    "\"version\" keyword missing in first line - this is not "
+                    "a valid debug info file");
+        return 0;
+    }
+
+    /* Parse the version directive */
+    ParseVersion (D);
+
+    /* Do several checks on the version number */
+    if (D->Info->MajorVersion < VER_MAJOR) {
+        ParseError (
+            D, CC65_ERROR,
+            "This is an old version of the debug info format that is no "
+            "longer supported. Version found = %u.%u, version supported "
+            "= %u.%u",
+            D->Info->MajorVersion, D->Info->MinorVersion,
+            VER_MAJOR, VER_MINOR
+        );
+        return 0;
+    } else if (D->Info->MajorVersion == VER_MAJOR &&
+               D->Info->MinorVersion > VER_MINOR) {
+        ParseError (
+            D, CC65_ERROR,
+            "This is a slightly newer version of the debug info format. "
+            "It might work, but you may get errors about unknown keywords "
+            "and similar. Version found = %u.%u, version supported = %u.%u",
+            D->Info->MajorVersion, D->Info->MinorVersion,
+            VER_MAJOR, VER_MINOR
+        );
+    } else if (D->Info->MajorVersion > VER_MAJOR) {
+        ParseError (
+            D, CC65_WARNING,
+            "The format of this debug info file is newer than what we "
+            "know. Will proceed but probably fail. Version found = %u.%u, "
+            "version supported = %u.%u",
+            D->Info->MajorVersion, D->Info->MinorVersion,
+            VER_MAJOR, VER_MINOR
+        );
+    }
+
+    return 1;
+}
+
+
+
+static DbgInfo* FinishDbgInfo (InputData* D)
+/* Postprocess the debug info after the input has been parsed completely, and
+** return it. In case of errors, the debug info is freed and NULL returned.
+*/
+{
+    /* In case of errors, delete the debug info already allocated and
+    ** return NULL
+    */
+    if (D->Errors > 0) {
+        /* Free allocated stuff */
+        FreeDbgInfo (D->Info);
+        return 0;
+    }
+
+    /* We do now have all the information from the input file. Do
+    ** postprocessing. Beware: Some of the following postprocessing
+    ** depends on the order of the calls. Ranking the names comes first,
+    ** since all sorting by name relies on it.
+    */
+    SP_Rank (&D->Info->Names);
+    if (D->Records & CC65_RECORD_CSYM) {
+        ProcessCSymInfo (D);
+    }
+    if (D->Records & CC65_RECORD_FILE) {
+        ProcessFileInfo (D);
+    }
+    if (D->Records & CC65_RECORD_LINE) {
+        ProcessLineInfo (D);
+    }
+    if (D->Records & CC65_RECORD_MOD) {
+        ProcessModInfo (D);
+    }
+    if (D->Records & CC65_RECORD_SCOPE) {
+        ProcessScopeInfo (D);
+    }
+    if (D->Records & CC65_RECORD_SEG) {
+        ProcessSegInfo (D);
+    }
+    if (D->Records & CC65_RECORD_SPAN) {
+        ProcessSpanInfo (D);
+    }
+    if (D->Records & CC65_RECORD_SYM) {
+        ProcessSymInfo (D);
+    }
+
+    /* Sort all collections that were queued above, then index them. The
+    ** secondary indexes are built later when they're used.
+    */
+    RunSorts (&D->Sorts);
+    IndexNames (D);
+    IndexSegs (D->Info);
+
+#if DEBUG
+    /* Debug output */
+    DumpData (D);
+#endif
+
+    /* Return the debug info struct that was created */
+    return D->Info;
+}
+
+
+
+static void ParseInput (InputData* D)
+/* Parse the complete input into a new debug info struct */
+{
+    /* Create a new debug info struct */
+    D->Info = NewDbgInfo (D->FileName);
+
+    /* Prime the pump */
+    NextToken (D);
+
+    /* Parse the version line, then the remaining lines. Large inputs are
+    ** split into chunks that are parsed by several threads.
+    */
+    if (ParseHeader (D)) {
+        if (D->Tok != TOK_EOL || !ParseParallel (D)) {
+            ConsumeEOL (D);
+            ParseRecords (D);
+        }
+    }
+}
+
+
+
+cc65_dbginfo cc65_read_dbginfo (const char* FileName, cc65_errorfunc ErrFunc)
+/* Parse the debug info file with the given name. On success, the function
+** will return a pointer to an opaque cc65_dbginfo structure, that must be
+** passed to the other functions in this module to retrieve information.
+** errorfunc is called in case of warnings and errors. If the file cannot be
+** read successfully, NULL is returned.
+*/
+{
+    return cc65_read_dbginfo_opt (FileName, 0, ErrFunc);
+}
+
+
+
+cc65_dbginfo cc65_read_dbginfo_opt (const char* FileName,
+                                    const cc65_dbgoptions* Options,
+                                    cc65_errorfunc ErrFunc)
+/* Parse the debug info file with the given name, using the given options.
+** Options may be NULL to use the defaults. Otherwise the same as
+** cc65_read_dbginfo.
+*/
+{
+    /* Data structure used to control scanning and parsing */
+    InputData D;
+    InitInputData (&D, FileName, Options, ErrFunc);
 
     /* Open the input file */
-    D.F = fopen (FileName, "rt");
-    if (D.F == 0) {
+    if (!OpenInput (&D)) {
         /* Cannot open */
         ParseError (&D, CC65_ERROR,
                     "Cannot open input file \"%s\": %s",
@@ -5634,171 +8062,196 @@ cc65_dbginfo cc65_read_dbginfo (const char* FileName, cc65_errorfunc ErrFunc)
         return 0;
     }
 
-    /* Create a new debug info struct */
-    D.Info = NewDbgInfo (FileName);
+    /* Parse the input */
+    ParseInput (&D);
+
+    /* Close the file */
+    CloseInput (&D);
+
+    /* Free memory allocated for the line buffer */
+    SB_Done (&D.LineBuf);
+
+    /* Postprocess and return the debug info */
+    return FinishDbgInfo (&D);
+}
+
+
+
+cc65_dbginfo cc65_read_dbginfo_mem (const char* Buf, size_t Len,
+                                    cc65_errorfunc ErrFunc)
+/* Parse debug info from the Len bytes in Buf. The data is not copied, but
+** it is only used during the call. Otherwise the same as cc65_read_dbginfo.
+*/
+{
+    /* Data structure used to control scanning and parsing */
+    InputData D;
+    InitInputData (&D, MEM_INPUT_NAME, 0, ErrFunc);
+
+    /* Scan the given buffer */
+    D.Buf = D.Pos = D.LineStart = Buf;
+    D.End = Buf + Len;
 
-    /* Prime the pump */
-    NextToken (&D);
+    /* Parse the input */
+    ParseInput (&D);
 
-    /* The first line in the file must specify version information */
-    if (D.Tok != TOK_VERSION) {
-        ParseError (&D, CC65_ERROR,
-                    "\"version\" keyword missing in first line - this is not "
-                    "a valid debug info file");
-        goto CloseAndExit;
-    }
+    /* Postprocess and return the debug info */
+    return FinishDbgInfo (&D);
+}
 
-    /* Parse the version directive */
-    ParseVersion (&D);
 
-    /* Do several checks on the version number */
-    if (D.Info->MajorVersion < VER_MAJOR) {
-        ParseError (
-            &D, CC65_ERROR,
-            "This is an old version of the debug info format that is no "
-            "longer supported. Version found = %u.%u, version supported "
-            "= %u.%u",
-            D.Info->MajorVersion, D.Info->MinorVersion,
-            VER_MAJOR, VER_MINOR
-        );
-        goto CloseAndExit;
-    } else if (D.Info->MajorVersion == VER_MAJOR &&
-               D.Info->MinorVersion > VER_MINOR) {
-        ParseError (
-            &D, CC65_ERROR,
-            "This is a slightly newer version of the debug info format. "
-            "It might work, but you may get errors about unknown keywords "
-            "and similar. Version found = %u.%u, version supported = %u.%u",
-            D.Info->MajorVersion, D.Info->MinorVersion,
-            VER_MAJOR, VER_MINOR
-        );
-    } else if (D.Info->MajorVersion > VER_MAJOR) {
-        ParseError (
-            &D, CC65_WARNING,
-            "The format of this debug info file is newer than what we "
-            "know. Will proceed but probably fail. Version found = %u.%u, "
-            "version supported = %u.%u",
-            D.Info->MajorVersion, D.Info->MinorVersion,
-            VER_MAJOR, VER_MINOR
-        );
+
+void cc65_free_dbginfo (cc65_dbginfo Handle)
+/* Free debug information read from a file */
+{
+    if (Handle) {
+        FreeDbgInfo ((DbgInfo*) Handle);
     }
-    ConsumeEOL (&D);
+}
 
-    /* Parse lines */
-    while (D.Tok != TOK_EOF) {
 
-        switch (D.Tok) {
 
-            case TOK_CSYM:
-                ParseCSym (&D);
-                break;
+/*****************************************************************************/
+/*                            Incremental parsing                            */
+/*****************************************************************************/
 
-            case TOK_FILE:
-                ParseFile (&D);
-                break;
 
-            case TOK_INFO:
-                ParseInfo (&D);
-                break;
 
-            case TOK_LIBRARY:
-                ParseLibrary (&D);
-                break;
+/* State of an incremental parser */
+struct cc65_dbgparser {
+    InputData           D;              /* Scanner and parser state */
+    StrBuf              Carry;          /* Incomplete last line of input */
+    int                 Started;        /* True if the header was parsed */
+    int                 Failed;         /* True if input is ignored */
+};
 
-            case TOK_LINE:
-                ParseLine (&D);
-                break;
 
-            case TOK_MODULE:
-                ParseModule (&D);
-                break;
 
-            case TOK_SCOPE:
-                ParseScope (&D);
-                break;
+static void ParseLines (cc65_dbgparser* P, const char* Start, const char* End)
+/* Parse the lines in Start..End. The scanner treats End as end of input, so
+** the text must either end with a newline or be the last of the input.
+*/
+{
+    InputData* D = &P->D;
 
-            case TOK_SEGMENT:
-                ParseSegment (&D);
-                break;
+    /* Scan the given text */
+    D->Buf   = D->Pos = D->LineStart = Start;
+    D->End   = End;
+    D->Block = 0;
+    D->C     = ' ';
 
-            case TOK_SPAN:
-                ParseSpan (&D);
-                break;
+    /* Prime the pump */
+    NextToken (D);
 
-            case TOK_SYM:
-                ParseSym (&D);
-                break;
+    /* The first line of the input must be the version line */
+    if (!P->Started) {
+        P->Started = 1;
+        if (!ParseHeader (D)) {
+            P->Failed = 1;
+            return;
+        }
+        ConsumeEOL (D);
+    }
 
-            case TOK_TYPE:
-                ParseType (&D);
-                break;
+    /* Parse the remaining lines */
+    ParseRecords (D);
+}
 
-            case TOK_IDENT:
-                /* Output a warning, then skip the line with the unknown
-                ** keyword that may have been added by a later version.
-                */
-                ParseError (&D, CC65_WARNING,
-                            "Unknown keyword \"%s\" - skipping",
-                            SB_GetConstBuf (&D.SVal));
 
-                SkipLine (&D);
-                break;
 
-            default:
-                UnexpectedToken (&D);
+cc65_dbgparser* cc65_dbgparser_new (const char* FileName,
+                                    const cc65_dbgoptions* Options,
+                                    cc65_errorfunc ErrFunc)
+/* Create an incremental parser for debug info. FileName is used in error
+** messages and for the debug info. It must stay valid until the parser is
+** finished. Options may be NULL to use the defaults.
+*/
+{
+    cc65_dbgparser* P = xmalloc (sizeof (cc65_dbgparser));
 
-        }
+    InitInputData (&P->D, FileName, Options, ErrFunc);
+    P->D.Info  = NewDbgInfo (FileName);
+    SB_Init (&P->Carry);
+    P->Started = 0;
+    P->Failed  = 0;
 
-        /* EOL or EOF must follow */
-        ConsumeEOL (&D);
-    }
+    return P;
+}
 
-CloseAndExit:
-    /* Close the file */
-    fclose (D.F);
 
-    /* Free memory allocated for SVal */
-    SB_Done (&D.SVal);
 
-    /* In case of errors, delete the debug info already allocated and
-    ** return NULL
-    */
-    if (D.Errors > 0) {
-        /* Free allocated stuff */
-        FreeDbgInfo (D.Info);
+int cc65_dbgparser_feed (cc65_dbgparser* P, const char* Buf, size_t Len)
+/* Feed the next Len bytes of input to the parser. Buf may end anywhere, even
+** within a token, and may be reused after the call returns. Complete lines
+** are parsed immediately, the rest is kept until more input arrives. Return
+** false if errors were found so far.
+*/
+{
+    const char* End = Buf + Len;
+    const char* Last = End;
+
+    if (P->Failed) {
         return 0;
     }
 
-    /* We do now have all the information from the input file. Do
-    ** postprocessing. Beware: Some of the following postprocessing
-    ** depends on the order of the calls.
-    */
-    ProcessCSymInfo (&D);
-    ProcessFileInfo (&D);
-    ProcessLineInfo (&D);
-    ProcessModInfo (&D);
-    ProcessScopeInfo (&D);
-    ProcessSegInfo (&D);
-    ProcessSpanInfo (&D);
-    ProcessSymInfo (&D);
+    /* Find the end of the last complete line */
+    while (Last > Buf && Last[-1] != '\n') {
+        --Last;
+    }
 
-#if DEBUG
-    /* Debug output */
-    DumpData (&D);
-#endif
+    if (Last > Buf) {
 
-    /* Return the debug info struct that was created */
-    return D.Info;
+        /* If there is a partial line left from the last call, complete it
+        ** and parse it separately.
+        */
+        if (SB_GetLen (&P->Carry) > 0) {
+            const char* NL = (const char*) memchr (Buf, '\n', Last - Buf) + 1;
+            SB_AppendBuf (&P->Carry, Buf, NL - Buf);
+            ParseLines (P, SB_GetConstBuf (&P->Carry),
+                        SB_GetConstBuf (&P->Carry) + SB_GetLen (&P->Carry));
+            SB_Clear (&P->Carry);
+            Buf = NL;
+        }
+
+        /* Parse the remaining complete lines in place */
+        if (Last > Buf && !P->Failed) {
+            ParseLines (P, Buf, Last);
+        }
+    }
+
+    /* Keep the incomplete last line */
+    if (!P->Failed) {
+        SB_AppendBuf (&P->Carry, Last, End - Last);
+    }
+
+    return P->D.Errors == 0;
 }
 
 
 
-void cc65_free_dbginfo (cc65_dbginfo Handle)
-/* Free debug information read from a file */
+cc65_dbginfo cc65_dbgparser_finish (cc65_dbgparser* P)
+/* Parse any remaining input and free the parser. On success, the debug info
+** is returned, otherwise NULL.
+*/
 {
-    if (Handle) {
-        FreeDbgInfo ((DbgInfo*) Handle);
+    cc65_dbginfo Info;
+
+    /* Parse the last line, if it isn't terminated by a newline. Parse an
+    ** empty input so errors are reported for it.
+    */
+    if (!P->Failed && (SB_GetLen (&P->Carry) > 0 || !P->Started)) {
+        ParseLines (P, SB_GetConstBuf (&P->Carry),
+                    SB_GetConstBuf (&P->Carry) + SB_GetLen (&P->Carry));
     }
+
+    /* Postprocess the debug info */
+    Info = FinishDbgInfo (&P->D);
+
+    /* Free the parser */
+    SB_Done (&P->Carry);
+    SB_Done (&P->D.LineBuf);
+    xfree (P);
+
+    return Info;
 }
 
 
@@ -5916,9 +8369,7 @@ const cc65_csyminfo* cc65_cfunc_byname (cc65_dbginfo Handle, const char* Name)
 */
 {
     const DbgInfo*      Info;
-    unsigned            Index;
-    unsigned            Count;
-    const CSymInfo*     S;
+    const NameGroup*    G;
     cc65_csyminfo*      D;
     unsigned            I;
 
@@ -5929,32 +8380,19 @@ const cc65_csyminfo* cc65_cfunc_byname (cc65_dbginfo Handle, const char* Name)
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
-    /* Search for a function with the given name */
-    if (!FindCSymInfoByName (&Info->CSymFuncByName, Name, &Index)) {
+    /* Search for the functions with the given name */
+    Name = PooledName (Info, Name);
+    G = Name? FindNameGroup (&Info->CSymFuncIndex, Name) : 0;
+    if (G == 0) {
         return 0;
     }
 
-    /* Count functions with this name */
-    Count = 1;
-    I = Index;
-    while (1) {
-        if (++I >= CollCount (&Info->CSymFuncByName)) {
-            break;
-        }
-        S = CollAt (&Info->CSymFuncByName, I);
-        if (strcmp (S->Name, Name) != 0) {
-            /* Next symbol has another name */
-            break;
-        }
-        ++Count;
-    }
-
     /* Allocate memory for the data structure returned to the caller */
-    D = new_cc65_csyminfo (Count);
+    D = new_cc65_csyminfo (G->Count);
 
     /* Fill in the data */
-    for (I = 0; I < Count; ++I, ++Index) {
-        CopyCSymInfo (D->data + I, CollAt (&Info->CSymFuncByName, Index));
+    for (I = 0; I < G->Count; ++I) {
+        CopyCSymInfo (D->data + I, CollAt (&Info->CSymFuncByName, G->First + I));
     }
 
     /* Return the result */
@@ -6153,6 +8591,9 @@ const cc65_lineinfo* cc65_line_bynumber (cc65_dbginfo Handle, unsigned FileId,
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
+    /* Make sure the lines of the files are sorted by line */
+    NeedIndex (Info, INDEX_LINES);
+
     /* Check if the source file id is valid */
     if (FileId >= CollCount (&Info->FileInfoById)) {
         return 0;
@@ -6210,6 +8651,9 @@ const cc65_lineinfo* cc65_line_bysource (cc65_dbginfo Handle, unsigned FileId)
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
+    /* Make sure the lines of the files are sorted by line */
+    NeedIndex (Info, INDEX_LINES);
+
     /* Check if the source file id is valid */
     if (FileId >= CollCount (&Info->FileInfoById)) {
         return 0;
@@ -6352,6 +8796,22 @@ const cc65_lineinfo* cc65_line_byspan (cc65_dbginfo Handle, unsigned SpanId)
 
 
 
+unsigned cc65_line_byaddr_batch (cc65_dbginfo Handle, const cc65_addr* Addrs,
+                                 unsigned Count, unsigned* LineIds)
+/* Look up the lines for Count addresses at once, see cc65_span_byaddr_batch.
+** For each address, the id of the first line of the innermost span with
+** lines is stored in LineIds.
+*/
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return FindIdsByAddr (Handle, Addrs, Count, LineIds, SpanLineId);
+}
+
+
+
 void cc65_free_lineinfo (cc65_dbginfo Handle, const cc65_lineinfo* Info)
 /* Free line info returned by one of the other functions */
 {
@@ -6364,6 +8824,67 @@ void cc65_free_lineinfo (cc65_dbginfo Handle, const cc65_lineinfo* Info)
 
 
 
+void cc65_line_data (const cc65_view* View, unsigned Index, cc65_linedata* D)
+/* Fill in the data for an item in a view of lines */
+{
+    CopyLineInfo (D, ViewAt (View, Index));
+}
+
+
+
+cc65_view cc65_line_bysource_view (cc65_dbginfo Handle, unsigned FileId)
+/* Return a view of the lines of a source file, see cc65_line_bysource */
+{
+    const DbgInfo*  Info;
+    const FileInfo* F;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Make sure the lines of the files are sorted by line */
+    NeedIndex (Info, INDEX_LINES);
+
+    /* Check if the source file id is valid */
+    if (FileId >= CollCount (&Info->FileInfoById)) {
+        return MakeView (0, 0, 0);
+    }
+
+    /* Return the lines of the file */
+    F = CollAt (&Info->FileInfoById, FileId);
+    return CollView (&F->LineInfoByLine);
+}
+
+
+
+cc65_view cc65_line_byspan_view (cc65_dbginfo Handle, unsigned SpanId)
+/* Return a view of the lines for a span, see cc65_line_byspan */
+{
+    const DbgInfo*  Info;
+    const SpanInfo* S;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Check if the span id is valid */
+    if (SpanId >= CollCount (&Info->SpanInfoById)) {
+        return MakeView (0, 0, 0);
+    }
+
+    /* Return the lines of the span. S->LineInfoList may be NULL, which gives
+    ** an empty view.
+    */
+    S = CollAt (&Info->SpanInfoById, SpanId);
+    return CollView (S->LineInfoList);
+}
+
+
+
 /*****************************************************************************/
 /*                                  Modules                                  */
 /*****************************************************************************/
@@ -6443,6 +8964,27 @@ void cc65_free_moduleinfo (cc65_dbginfo Handle, const cc65_moduleinfo* Info)
 
 
 
+void cc65_module_data (const cc65_view* View, unsigned Index,
+                       cc65_moduledata* D)
+/* Fill in the data for an item in a view of modules */
+{
+    CopyModInfo (D, ViewAt (View, Index));
+}
+
+
+
+cc65_view cc65_module_byid_view (cc65_dbginfo Handle, unsigned Id)
+/* Return a view of the module with a specific id, see cc65_module_byid */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return ItemView (&((const DbgInfo*) Handle)->ModInfoById, Id);
+}
+
+
+
 /*****************************************************************************/
 /*                                   Spans                                   */
 /*****************************************************************************/
@@ -6516,8 +9058,9 @@ const cc65_spaninfo* cc65_span_byaddr (cc65_dbginfo Handle, unsigned long Addr)
 */
 {
     const DbgInfo*      Info;
-    SpanInfoListEntry* E;
-    cc65_spaninfo*  D = 0;
+    const AddrMap*      M;
+    unsigned            Count;
+    cc65_spaninfo*      D = 0;
 
     /* Check the parameter */
     assert (Handle != 0);
@@ -6525,24 +9068,30 @@ const cc65_spaninfo* cc65_span_byaddr (cc65_dbginfo Handle, unsigned long Addr)
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
-    /* Search for spans that cover this address */
-    E = FindSpanInfoByAddr (&Info->SpanInfoByAddr, Addr);
-
-    /* Do we have spans? */
-    if (E != 0) {
-
-        unsigned I;
-
-        /* Prepare the struct we will return to the caller */
-        D = new_cc65_spaninfo (E->Count);
-        if (E->Count == 1) {
-            CopySpanInfo (D->data, E->Data);
-        } else {
-            for (I = 0; I < D->count; ++I) {
-                /* Copy data */
-                CopySpanInfo (D->data + I, ((SpanInfo**) E->Data)[I]);
+    /* Make sure the spans are indexed by address */
+    NeedIndex (Info, INDEX_SPANS);
+
+    /* Use the address map if there is one. Otherwise search the tree. */
+    M = GetSpanMap (Info);
+    if (M) {
+        const SpanInfo** Spans = FindSpansInAddrMap (M, Addr, &Count);
+        if (Count > 0) {
+            unsigned I;
+            D = new_cc65_spaninfo (Count);
+            for (I = 0; I < Count; ++I) {
+                CopySpanInfo (D->data + I, Spans[I]);
             }
         }
+    } else {
+        /* Count the spans that cover this address */
+        Count = FindSpanInfoByAddr (&Info->SpanInfoByAddr, Addr, 0, 0);
+
+        /* Do we have spans? */
+        if (Count > 0) {
+            /* Prepare the struct we will return to the caller and fill it */
+            D = new_cc65_spaninfo (Count);
+            FindSpanInfoByAddr (&Info->SpanInfoByAddr, Addr, D->data, 0);
+        }
     }
 
     /* Return the struct we've created */
@@ -6551,6 +9100,22 @@ const cc65_spaninfo* cc65_span_byaddr (cc65_dbginfo Handle, unsigned long Addr)
 
 
 
+unsigned cc65_span_byaddr_batch (cc65_dbginfo Handle, const cc65_addr* Addrs,
+                                 unsigned Count, unsigned* SpanIds)
+/* Look up the spans for Count addresses at once. For each address, the id
+** of the innermost span that covers it is stored in SpanIds, or CC65_INV_ID
+** if there is none. The function returns the number of addresses found.
+*/
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return FindIdsByAddr (Handle, Addrs, Count, SpanIds, SpanId);
+}
+
+
+
 const cc65_spaninfo* cc65_span_byline (cc65_dbginfo Handle, unsigned LineId)
 /* Return span information for the given source line. The function returns NULL
 ** if the line id is invalid, otherwise the spans for this line (possibly zero).
@@ -6635,8 +9200,72 @@ void cc65_free_spaninfo (cc65_dbginfo Handle, const cc65_spaninfo* Info)
     /* Just for completeness, check the handle */
     assert (Handle != 0);
 
-    /* Just free the memory */
-    xfree ((cc65_spaninfo*) Info);
+    /* Just free the memory */
+    xfree ((cc65_spaninfo*) Info);
+}
+
+
+
+void cc65_span_data (const cc65_view* View, unsigned Index, cc65_spandata* D)
+/* Fill in the data for an item in a view of spans */
+{
+    CopySpanInfo (D, ViewAt (View, Index));
+}
+
+
+
+cc65_view cc65_get_spanlist_view (cc65_dbginfo Handle)
+/* Return a view of all spans */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return CollView (&((const DbgInfo*) Handle)->SpanInfoById);
+}
+
+
+
+cc65_view cc65_get_spanlist_byaddr_view (cc65_dbginfo Handle)
+/* Return a view of all spans sorted by address */
+{
+    const DbgInfo*      Info;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Make sure the spans are sorted */
+    NeedIndex (Info, INDEX_SPANORDER);
+
+    /* Return all spans */
+    return CollView (&Info->SpanInfoByStart);
+}
+
+
+
+cc65_view cc65_span_byline_view (cc65_dbginfo Handle, unsigned LineId)
+/* Return a view of the spans for a source line, see cc65_span_byline */
+{
+    const DbgInfo*      Info;
+    const LineInfo*     L;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Check if the line id is valid */
+    if (LineId >= CollCount (&Info->LineInfoById)) {
+        return MakeView (0, 0, 0);
+    }
+
+    /* Return the spans of the line */
+    L = CollAt (&Info->LineInfoById, LineId);
+    return CollView (&L->SpanInfoList);
 }
 
 
@@ -6760,6 +9389,39 @@ void cc65_free_sourceinfo (cc65_dbginfo Handle, const cc65_sourceinfo* Info)
 
 
 
+void cc65_source_data (const cc65_view* View, unsigned Index,
+                       cc65_sourcedata* D)
+/* Fill in the data for an item in a view of source files */
+{
+    CopyFileInfo (D, ViewAt (View, Index));
+}
+
+
+
+cc65_view cc65_get_sourcelist_view (cc65_dbginfo Handle)
+/* Return a view of all source files */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return CollView (&((const DbgInfo*) Handle)->FileInfoById);
+}
+
+
+
+cc65_view cc65_source_byid_view (cc65_dbginfo Handle, unsigned Id)
+/* Return a view of the source file with a specific id, see cc65_source_byid */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return ItemView (&((const DbgInfo*) Handle)->FileInfoById, Id);
+}
+
+
+
 /*****************************************************************************/
 /*                                  Scopes                                   */
 /*****************************************************************************/
@@ -6841,6 +9503,9 @@ const cc65_scopeinfo* cc65_scope_bymodule (cc65_dbginfo Handle, unsigned ModId)
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
+    /* Make sure the scopes are sorted by name */
+    NeedIndex (Info, INDEX_SCOPES);
+
     /* Check if the module id is valid */
     if (ModId >= CollCount (&Info->ModInfoById)) {
         return 0;
@@ -6869,10 +9534,8 @@ const cc65_scopeinfo* cc65_scope_byname (cc65_dbginfo Handle, const char* Name)
 */
 {
     const DbgInfo*      Info;
-    unsigned            Index;
-    const ScopeInfo*    S;
+    const NameGroup*    G;
     cc65_scopeinfo*     D;
-    unsigned            Count;
     unsigned            I;
 
 
@@ -6882,33 +9545,23 @@ const cc65_scopeinfo* cc65_scope_byname (cc65_dbginfo Handle, const char* Name)
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
-    /* Search for the first item with the given name */
-    if (!FindScopeInfoByName (&Info->ScopeInfoByName, Name, &Index)) {
+    /* Make sure the scopes are indexed by name */
+    NeedIndex (Info, INDEX_SCOPES);
+
+    /* Search for the scopes with the given name */
+    Name = PooledName (Info, Name);
+    G = Name? FindNameGroup (&Info->ScopeIndex, Name) : 0;
+    if (G == 0) {
         /* Not found */
         return 0;
     }
 
-    /* Count scopes with this name */
-    Count = 1;
-    I = Index;
-    while (1) {
-        if (++I >= CollCount (&Info->ScopeInfoByName)) {
-            break;
-        }
-        S = CollAt (&Info->ScopeInfoByName, I);
-        if (strcmp (S->Name, Name) != 0) {
-            /* Next symbol has another name */
-            break;
-        }
-        ++Count;
-    }
-
     /* Allocate memory for the data structure returned to the caller */
-    D = new_cc65_scopeinfo (Count);
+    D = new_cc65_scopeinfo (G->Count);
 
     /* Fill in the data */
-    for (I = 0; I < Count; ++I, ++Index) {
-        CopyScopeInfo (D->data + I, CollAt (&Info->ScopeInfoByName, Index));
+    for (I = 0; I < G->Count; ++I) {
+        CopyScopeInfo (D->data + I, CollAt (&Info->ScopeInfoByName, G->First + I));
     }
 
     /* Return the result */
@@ -6958,6 +9611,22 @@ const cc65_scopeinfo* cc65_scope_byspan (cc65_dbginfo Handle, unsigned SpanId)
 
 
 
+unsigned cc65_scope_byaddr_batch (cc65_dbginfo Handle, const cc65_addr* Addrs,
+                                  unsigned Count, unsigned* ScopeIds)
+/* Look up the scopes for Count addresses at once, see cc65_span_byaddr_batch.
+** For each address, the id of the first scope of the innermost span with
+** scopes is stored in ScopeIds.
+*/
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return FindIdsByAddr (Handle, Addrs, Count, ScopeIds, SpanScopeId);
+}
+
+
+
 const cc65_scopeinfo* cc65_childscopes_byid (cc65_dbginfo Handle, unsigned Id)
 /* Return the direct child scopes of a scope with a given id. The function
 ** returns NULL if no scope with this id was found, otherwise a list of the
@@ -7009,6 +9678,64 @@ void cc65_free_scopeinfo (cc65_dbginfo Handle, const cc65_scopeinfo* Info)
 
 
 
+void cc65_scope_data (const cc65_view* View, unsigned Index, cc65_scopedata* D)
+/* Fill in the data for an item in a view of scopes */
+{
+    CopyScopeInfo (D, ViewAt (View, Index));
+}
+
+
+
+cc65_view cc65_get_scopelist_view (cc65_dbginfo Handle)
+/* Return a view of all scopes */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return CollView (&((const DbgInfo*) Handle)->ScopeInfoById);
+}
+
+
+
+cc65_view cc65_scope_byid_view (cc65_dbginfo Handle, unsigned Id)
+/* Return a view of the scope with a given id, see cc65_scope_byid */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return ItemView (&((const DbgInfo*) Handle)->ScopeInfoById, Id);
+}
+
+
+
+cc65_view cc65_scope_byname_view (cc65_dbginfo Handle, const char* Name)
+/* Return a view of the scopes with a given name, see cc65_scope_byname */
+{
+    const DbgInfo*      Info;
+    const NameGroup*    G;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Make sure the scopes are indexed by name */
+    NeedIndex (Info, INDEX_SCOPES);
+
+    /* Search for the scopes with the given name */
+    Name = PooledName (Info, Name);
+    G = Name? FindNameGroup (&Info->ScopeIndex, Name) : 0;
+    if (G == 0) {
+        return MakeView (0, 0, 0);
+    }
+    return MakeView (&Info->ScopeInfoByName, G->First, G->Count);
+}
+
+
+
 /*****************************************************************************/
 /*                                 Segments                                  */
 /*****************************************************************************/
@@ -7084,7 +9811,7 @@ const cc65_segmentinfo* cc65_segment_byname (cc65_dbginfo Handle,
 */
 {
     const DbgInfo*      Info;
-    const SegInfo*      S;
+    const NameGroup*    G;
     cc65_segmentinfo*   D;
 
     /* Check the parameter */
@@ -7094,8 +9821,9 @@ const cc65_segmentinfo* cc65_segment_byname (cc65_dbginfo Handle,
     Info = Handle;
 
     /* Search for the segment */
-    S = FindSegInfoByName (&Info->SegInfoByName, Name);
-    if (S == 0) {
+    Name = PooledName (Info, Name);
+    G = Name? FindNameGroup (&Info->SegIndex, Name) : 0;
+    if (G == 0) {
         return 0;
     }
 
@@ -7103,7 +9831,7 @@ const cc65_segmentinfo* cc65_segment_byname (cc65_dbginfo Handle,
     D = new_cc65_segmentinfo (1);
 
     /* Fill in the data */
-    CopySegInfo (D->data, S);
+    CopySegInfo (D->data, CollAt (&Info->SegInfoByName, G->First));
 
     /* Return the result */
     return D;
@@ -7123,6 +9851,72 @@ void cc65_free_segmentinfo (cc65_dbginfo Handle, const cc65_segmentinfo* Info)
 
 
 
+void cc65_segment_data (const cc65_view* View, unsigned Index,
+                        cc65_segmentdata* D)
+/* Fill in the data for an item in a view of segments */
+{
+    CopySegInfo (D, ViewAt (View, Index));
+}
+
+
+
+cc65_view cc65_get_segmentlist_view (cc65_dbginfo Handle)
+/* Return a view of all segments */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return CollView (&((const DbgInfo*) Handle)->SegInfoById);
+}
+
+
+
+cc65_view cc65_segment_byid_view (cc65_dbginfo Handle, unsigned Id)
+/* Return a view of the segment with a specific id, see cc65_segment_byid */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return ItemView (&((const DbgInfo*) Handle)->SegInfoById, Id);
+}
+
+
+
+cc65_view cc65_get_segmentlist_byaddr_view (cc65_dbginfo Handle)
+/* Return a view of all segments sorted by address */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return CollView (&((const DbgInfo*) Handle)->SegInfoByAddr);
+}
+
+
+
+cc65_view cc65_segment_byaddr_view (cc65_dbginfo Handle, cc65_addr Addr)
+/* Return a view of the segment that contains an address */
+{
+    const DbgInfo*      Info;
+    unsigned            Index;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Search for the segment */
+    if (!FindSegInfoByAddr (&Info->SegInfoByAddr, Addr, &Index)) {
+        return MakeView (0, 0, 0);
+    }
+    return MakeView (&Info->SegInfoByAddr, Index, 1);
+}
+
+
+
 /*****************************************************************************/
 /*                                  Symbols                                  */
 /*****************************************************************************/
@@ -7166,10 +9960,9 @@ const cc65_symbolinfo* cc65_symbol_byname (cc65_dbginfo Handle, const char* Name
 */
 {
     const DbgInfo*      Info;
+    const NameGroup*    G;
     cc65_symbolinfo*    D;
     unsigned            I;
-    unsigned            Index;
-    unsigned            Count;
 
     /* Check the parameter */
     assert (Handle != 0);
@@ -7177,31 +9970,24 @@ const cc65_symbolinfo* cc65_symbol_byname (cc65_dbginfo Handle, const char* Name
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
-    /* Search for the symbol */
-    if (!FindSymInfoByName (&Info->SymInfoByName, Name, &Index)) {
+    /* Make sure the symbols are indexed by name */
+    NeedIndex (Info, INDEX_SYMBOLS);
+
+    /* Search for the symbols. The index knows how many there are. */
+    Name = PooledName (Info, Name);
+    G = Name? FindNameGroup (&Info->SymIndex, Name) : 0;
+    if (G == 0) {
         /* Not found */
         return 0;
     }
 
-    /* Index contains the position. Count how many symbols with this name
-    ** we have. Skip the first one, since we have at least one.
-    */
-    Count = 1;
-    while ((unsigned) Index + Count < CollCount (&Info->SymInfoByName)) {
-        const SymInfo* S = CollAt (&Info->SymInfoByName, (unsigned) Index + Count);
-        if (strcmp (S->Name, Name) != 0) {
-            break;
-        }
-        ++Count;
-    }
-
     /* Allocate memory for the data structure returned to the caller */
-    D = new_cc65_symbolinfo (Count);
+    D = new_cc65_symbolinfo (G->Count);
 
     /* Fill in the data */
-    for (I = 0; I < Count; ++I) {
+    for (I = 0; I < G->Count; ++I) {
         /* Copy the data */
-        CopySymInfo (D->data + I, CollAt (&Info->SymInfoByName, Index++));
+        CopySymInfo (D->data + I, CollAt (&Info->SymInfoByName, G->First + I));
     }
 
     /* Return the result */
@@ -7229,6 +10015,9 @@ const cc65_symbolinfo* cc65_symbol_byscope (cc65_dbginfo Handle, unsigned ScopeI
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
+    /* Make sure the symbols are sorted by name */
+    NeedIndex (Info, INDEX_SYMBOLS);
+
     /* Check if the id is valid */
     if (ScopeId >= CollCount (&Info->ScopeInfoById)) {
         return 0;
@@ -7260,10 +10049,10 @@ const cc65_symbolinfo* cc65_symbol_inrange (cc65_dbginfo Handle, cc65_addr Start
 */
 {
     const DbgInfo*      Info;
-    Collection          SymInfoList = COLLECTION_INITIALIZER;
     cc65_symbolinfo*    D;
     unsigned            I;
     unsigned            Index;
+    unsigned            Count;
 
     /* Check the parameter */
     assert (Handle != 0);
@@ -7271,54 +10060,26 @@ const cc65_symbolinfo* cc65_symbol_inrange (cc65_dbginfo Handle, cc65_addr Start
     /* The handle is actually a pointer to a debug info struct */
     Info = Handle;
 
-    /* Search for the symbol. Because we're searching for a range, we cannot
-    ** make use of the function result.
-    */
-    FindSymInfoByValue (&Info->SymInfoByVal, Start, &Index);
-
-    /* Start from the given index, check all symbols until the end address is
-    ** reached. Place all symbols into SymInfoList for later.
-    */
-    for (I = Index; I < CollCount (&Info->SymInfoByVal); ++I) {
-
-        /* Get the item */
-        SymInfo* Item = CollAt (&Info->SymInfoByVal, I);
-
-        /* The collection is sorted by address, so if we get a value larger
-        ** than the end address, we're done.
-        */
-        if (Item->Value > (long) End) {
-            break;
-        }
-
-        /* Ignore non-labels (this will also ignore imports) */
-        if (Item->Type != CC65_SYM_LABEL) {
-            continue;
-        }
-
-        /* Ok, remember this one */
-        CollAppend (&SymInfoList, Item);
-    }
+    /* Make sure the labels are sorted by value */
+    NeedIndex (Info, INDEX_SYMVALS);
 
-    /* If we don't have any labels within the range, bail out. No memory has
-    ** been allocated for SymInfoList.
+    /* Search for the labels. If we don't have any within the range, bail
+    ** out.
     */
-    if (CollCount (&SymInfoList) == 0) {
+    Count = FindLabelsInRange (Info, Start, End, &Index);
+    if (Count == 0) {
         return 0;
     }
 
     /* Allocate memory for the data structure returned to the caller */
-    D = new_cc65_symbolinfo (CollCount (&SymInfoList));
+    D = new_cc65_symbolinfo (Count);
 
     /* Fill in the data */
-    for (I = 0; I < CollCount (&SymInfoList); ++I) {
+    for (I = 0; I < Count; ++I) {
         /* Copy the data */
-        CopySymInfo (D->data + I, CollAt (&SymInfoList, I));
+        CopySymInfo (D->data + I, CollAt (&Info->LabelInfoByVal, Index + I));
     }
 
-    /* Free the collection */
-    CollDone (&SymInfoList);
-
     /* Return the result */
     return D;
 }
@@ -7337,6 +10098,136 @@ void cc65_free_symbolinfo (cc65_dbginfo Handle, const cc65_symbolinfo* Info)
 
 
 
+void cc65_symbol_data (const cc65_view* View, unsigned Index,
+                       cc65_symboldata* D)
+/* Fill in the data for an item in a view of symbols */
+{
+    CopySymInfo (D, ViewAt (View, Index));
+}
+
+
+
+cc65_view cc65_get_symbollist_view (cc65_dbginfo Handle)
+/* Return a view of all symbols */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return CollView (&((const DbgInfo*) Handle)->SymInfoById);
+}
+
+
+
+cc65_view cc65_symbol_byid_view (cc65_dbginfo Handle, unsigned Id)
+/* Return a view of the symbol with a given id, see cc65_symbol_byid */
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return ItemView (&((const DbgInfo*) Handle)->SymInfoById, Id);
+}
+
+
+
+cc65_view cc65_symbol_byname_view (cc65_dbginfo Handle, const char* Name)
+/* Return a view of the symbols with a given name, see cc65_symbol_byname */
+{
+    const DbgInfo*      Info;
+    const NameGroup*    G;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Make sure the symbols are indexed by name */
+    NeedIndex (Info, INDEX_SYMBOLS);
+
+    /* Search for the symbols with the given name */
+    Name = PooledName (Info, Name);
+    G = Name? FindNameGroup (&Info->SymIndex, Name) : 0;
+    if (G == 0) {
+        return MakeView (0, 0, 0);
+    }
+    return MakeView (&Info->SymInfoByName, G->First, G->Count);
+}
+
+
+
+cc65_view cc65_symbol_inrange_view (cc65_dbginfo Handle, cc65_addr Start,
+                                    cc65_addr End)
+/* Return a view of the labels in the given range, see cc65_symbol_inrange.
+** The labels are sorted by value.
+*/
+{
+    const DbgInfo*      Info;
+    unsigned            Index;
+    unsigned            Count;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Make sure the labels are sorted by value */
+    NeedIndex (Info, INDEX_SYMVALS);
+
+    /* Return the labels in the range */
+    Count = FindLabelsInRange (Info, Start, End, &Index);
+    return MakeView (&Info->LabelInfoByVal, Index, Count);
+}
+
+
+
+unsigned cc65_symbol_nearest (cc65_dbginfo Handle, cc65_addr Addr,
+                              cc65_addr* Offset)
+/* Return the id of the label with the highest value at or below Addr, or
+** CC65_INV_ID if there is none. If Offset isn't NULL, the distance of Addr
+** from the label is stored there.
+*/
+{
+    const DbgInfo*      Info;
+    const SymInfo*      S;
+
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    Info = Handle;
+
+    /* Make sure the labels are sorted by value */
+    NeedIndex (Info, INDEX_SYMVALS);
+
+    /* Search for the label */
+    S = FindLabelBelow (Info, Addr);
+    if (Offset) {
+        *Offset = S? Addr - (cc65_addr) S->Value : 0;
+    }
+    return S? S->Id : CC65_INV_ID;
+}
+
+
+
+unsigned cc65_symbol_nearest_batch (cc65_dbginfo Handle,
+                                    const cc65_addr* Addrs, unsigned Count,
+                                    unsigned* SymIds, cc65_addr* Offsets)
+/* Look up the nearest labels for Count addresses at once, see
+** cc65_symbol_nearest. Returns the number of addresses with a label.
+*/
+{
+    /* Check the parameter */
+    assert (Handle != 0);
+
+    /* The handle is actually a pointer to a debug info struct */
+    return FindLabelsByAddr (Handle, Addrs, Count, SymIds, Offsets);
+}
+
+
+
 /*****************************************************************************/
 /*                                   Types                                   */
 /*****************************************************************************/
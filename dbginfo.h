@@ -38,6 +38,10 @@
 
 
 
+#include <stddef.h>
+
+
+
 /* Allow usage from C++ */
 #ifdef __cplusplus
 extern "C" {
@@ -61,6 +65,27 @@ typedef unsigned cc65_size;             /* Used to store (65xx) sizes */
 /* A value that is used to mark invalid ids */
 #define CC65_INV_ID     (~0U)
 
+/* All names returned (symbols, C symbols, scopes, files, modules, libraries,
+** segments and output files) are kept in one pool per debug info. Two names
+** from the same debug info are equal if and only if the pointers are equal,
+** so they may be compared without strcmp. The pointers stay valid until the
+** debug info is freed.
+*/
+
+/* A view is a list of items that is borrowed from the debug info instead of
+** being copied like the lists returned by the cc65_..._by... functions.
+** Getting a view allocates nothing, and it stays valid until the debug info
+** is freed, so there is no function to free it. The data for an item is read
+** with the cc65_..._data function for the kind of item in the view. Where
+** the copying function returns NULL, the view function returns an empty
+** view.
+*/
+typedef struct cc65_view cc65_view;
+struct cc65_view {
+    unsigned            count;          /* Number of items in the view */
+    const void*         priv;           /* Items, private to the module */
+};
+
 
 
 /*****************************************************************************/
@@ -103,10 +128,79 @@ cc65_dbginfo cc65_read_dbginfo (const char* filename, cc65_errorfunc errorfunc);
 ** read successfully, NULL is returned.
 */
 
+/* Record kinds in a debug info file, used in cc65_dbgoptions */
+#define CC65_RECORD_CSYM        0x0001U
+#define CC65_RECORD_FILE        0x0002U
+#define CC65_RECORD_LIB         0x0004U
+#define CC65_RECORD_LINE        0x0008U
+#define CC65_RECORD_MOD         0x0010U
+#define CC65_RECORD_SCOPE       0x0020U
+#define CC65_RECORD_SEG         0x0040U
+#define CC65_RECORD_SPAN        0x0080U
+#define CC65_RECORD_SYM         0x0100U
+#define CC65_RECORD_TYPE        0x0200U
+#define CC65_RECORD_ALL         0x03FFU
+
+/* Options for reading debug info */
+typedef struct cc65_dbgoptions cc65_dbgoptions;
+struct cc65_dbgoptions {
+    unsigned            records;        /* Record kinds to load, 0 = all */
+    unsigned long       addrmap_budget; /* Bytes for address table, 0 = 16MB */
+};
+
+cc65_dbginfo cc65_read_dbginfo_opt (const char* filename,
+                                    const cc65_dbgoptions* options,
+                                    cc65_errorfunc errorfunc);
+/* Parse the debug info file with the given name, using the given options.
+** options may be NULL to use the defaults. Record kinds not in
+** options->records are skipped without parsing them, and references to them
+** are left unresolved: Ids of such items are returned as CC65_INV_ID, and
+** lists of them are empty. Some record kinds cannot do without others, so
+** the scopes, modules and files needed by symbols, scopes and modules are
+** always loaded, as are files for lines and segments for spans.
+** options->addrmap_budget limits the memory for a table that maps each
+** address directly to its spans. The spans are indexed by the first lookup
+** by address: This builds a tree over the spans, and the table if the address
+** range of all spans fits into the budget; otherwise lookups search the
+** tree. cc65_get_spanlist_byaddr_view only sorts the spans and builds
+** neither. Otherwise the same as cc65_read_dbginfo.
+*/
+
+cc65_dbginfo cc65_read_dbginfo_mem (const char* buf, size_t len,
+                                    cc65_errorfunc errorfunc);
+/* Parse debug info from the len bytes in buf, for example the output of the
+** linker that is already in memory. The buffer needs not be terminated and
+** is not used after the call returns. Errors are reported for the input name
+** "<memory>". Otherwise the same as cc65_read_dbginfo.
+*/
+
 void cc65_free_dbginfo (cc65_dbginfo Handle);
 /* Free debug information read from a file */
 
 
+/* Opaque state of an incremental debug info parser */
+typedef struct cc65_dbgparser cc65_dbgparser;
+
+cc65_dbgparser* cc65_dbgparser_new (const char* filename,
+                                    const cc65_dbgoptions* options,
+                                    cc65_errorfunc errorfunc);
+/* Create an incremental parser for debug info, for input that arrives in
+** pieces, for example from a pipe. filename is used in error messages and
+** for the debug info, it must stay valid until the parser is finished.
+** options may be NULL to use the defaults, see cc65_read_dbginfo_opt.
+*/
+
+int cc65_dbgparser_feed (cc65_dbgparser* parser, const char* buf, size_t len);
+/* Feed the next len bytes of input to the parser. The input may be split at
+** any position. Returns false if errors were found so far.
+*/
+
+cc65_dbginfo cc65_dbgparser_finish (cc65_dbgparser* parser);
+/* Parse any remaining input and free the parser. Returns the debug info as
+** cc65_read_dbginfo does, or NULL in case of errors.
+*/
+
+
 
 /*****************************************************************************/
 /*                                 C Symbols                                 */
@@ -282,9 +376,26 @@ const cc65_lineinfo* cc65_line_byspan (cc65_dbginfo handle, unsigned span_id);
 ** span id is invalid, otherwise a list of line infos.
 */
 
+unsigned cc65_line_byaddr_batch (cc65_dbginfo handle, const cc65_addr* addrs,
+                                 unsigned count, unsigned* line_ids);
+/* Look up the lines for count addresses at once, see cc65_span_byaddr_batch.
+** For each address, the id of the first line of the innermost span that has
+** lines is stored in line_ids.
+*/
+
 void cc65_free_lineinfo (cc65_dbginfo handle, const cc65_lineinfo* info);
 /* Free line info returned by one of the other functions */
 
+void cc65_line_data (const cc65_view* view, unsigned index,
+                     cc65_linedata* data);
+/* Fill in the data for an item in a view of lines */
+
+cc65_view cc65_line_bysource_view (cc65_dbginfo handle, unsigned source_id);
+/* Return a view of the lines of a source file, see cc65_line_bysource */
+
+cc65_view cc65_line_byspan_view (cc65_dbginfo handle, unsigned span_id);
+/* Return a view of the lines for a span, see cc65_line_byspan */
+
 
 
 /*****************************************************************************/
@@ -328,6 +439,13 @@ const cc65_moduleinfo* cc65_module_byid (cc65_dbginfo handle, unsigned id);
 void cc65_free_moduleinfo (cc65_dbginfo handle, const cc65_moduleinfo* info);
 /* Free a module info record */
 
+void cc65_module_data (const cc65_view* view, unsigned index,
+                       cc65_moduledata* data);
+/* Fill in the data for an item in a view of modules */
+
+cc65_view cc65_module_byid_view (cc65_dbginfo handle, unsigned id);
+/* Return a view of the module with a specific id, see cc65_module_byid */
+
 
 
 /*****************************************************************************/
@@ -372,6 +490,17 @@ const cc65_spaninfo* cc65_span_byaddr (cc65_dbginfo handle,
 ** if no spans were found for this address.
 */
 
+unsigned cc65_span_byaddr_batch (cc65_dbginfo handle, const cc65_addr* addrs,
+                                 unsigned count, unsigned* span_ids);
+/* Look up the spans for count addresses at once, for example all addresses
+** of a trace. For each address in addrs, the id of the innermost span that
+** covers it is stored at the same index in span_ids, or CC65_INV_ID if there
+** is none. The innermost span is the smallest one; spans of the same size
+** are ordered by id. The function returns the number of addresses found.
+** It allocates no result and is much faster than calling cc65_span_byaddr
+** for each address.
+*/
+
 const cc65_spaninfo* cc65_span_byline (cc65_dbginfo handle, unsigned line_id);
 /* Return span information for the given source line. The function returns NULL
 ** if the line id is invalid, otherwise the spans for this line (possibly zero).
@@ -385,6 +514,21 @@ const cc65_spaninfo* cc65_span_byscope (cc65_dbginfo handle, unsigned scope_id);
 void cc65_free_spaninfo (cc65_dbginfo handle, const cc65_spaninfo* info);
 /* Free a span info record */
 
+void cc65_span_data (const cc65_view* view, unsigned index,
+                     cc65_spandata* data);
+/* Fill in the data for an item in a view of spans */
+
+cc65_view cc65_get_spanlist_view (cc65_dbginfo handle);
+/* Return a view of all spans */
+
+cc65_view cc65_get_spanlist_byaddr_view (cc65_dbginfo handle);
+/* Return a view of all spans sorted by address. Spans with the same start
+** address are sorted by end address, smaller spans first.
+*/
+
+cc65_view cc65_span_byline_view (cc65_dbginfo handle, unsigned line_id);
+/* Return a view of the spans for a source line, see cc65_span_byline */
+
 
 
 /*****************************************************************************/
@@ -430,6 +574,16 @@ const cc65_sourceinfo* cc65_source_bymodule (cc65_dbginfo handle,
 void cc65_free_sourceinfo (cc65_dbginfo handle, const cc65_sourceinfo* info);
 /* Free a source info record */
 
+void cc65_source_data (const cc65_view* view, unsigned index,
+                       cc65_sourcedata* data);
+/* Fill in the data for an item in a view of source files */
+
+cc65_view cc65_get_sourcelist_view (cc65_dbginfo handle);
+/* Return a view of all source files */
+
+cc65_view cc65_source_byid_view (cc65_dbginfo handle, unsigned id);
+/* Return a view of the source file with a specific id, see cc65_source_byid */
+
 
 
 /*****************************************************************************/
@@ -489,6 +643,13 @@ const cc65_scopeinfo* cc65_scope_byspan (cc65_dbginfo handle, unsigned span_id);
 ** span id is invalid, otherwise a list of line scopes.
 */
 
+unsigned cc65_scope_byaddr_batch (cc65_dbginfo handle, const cc65_addr* addrs,
+                                  unsigned count, unsigned* scope_ids);
+/* Look up the scopes for count addresses at once, see cc65_span_byaddr_batch.
+** For each address, the id of the first scope of the innermost span that has
+** scopes is stored in scope_ids.
+*/
+
 const cc65_scopeinfo* cc65_childscopes_byid (cc65_dbginfo handle, unsigned id);
 /* Return the direct child scopes of a scope with a given id. The function
 ** returns NULL if no scope with this id was found, otherwise a list of the
@@ -498,6 +659,19 @@ const cc65_scopeinfo* cc65_childscopes_byid (cc65_dbginfo handle, unsigned id);
 void cc65_free_scopeinfo (cc65_dbginfo Handle, const cc65_scopeinfo* Info);
 /* Free a scope info record */
 
+void cc65_scope_data (const cc65_view* view, unsigned index,
+                      cc65_scopedata* data);
+/* Fill in the data for an item in a view of scopes */
+
+cc65_view cc65_get_scopelist_view (cc65_dbginfo handle);
+/* Return a view of all scopes */
+
+cc65_view cc65_scope_byid_view (cc65_dbginfo handle, unsigned id);
+/* Return a view of the scope with a given id, see cc65_scope_byid */
+
+cc65_view cc65_scope_byname_view (cc65_dbginfo handle, const char* name);
+/* Return a view of the scopes with a given name, see cc65_scope_byname */
+
 
 
 /*****************************************************************************/
@@ -551,6 +725,27 @@ const cc65_segmentinfo* cc65_segment_byname (cc65_dbginfo handle,
 void cc65_free_segmentinfo (cc65_dbginfo handle, const cc65_segmentinfo* info);
 /* Free a segment info record */
 
+void cc65_segment_data (const cc65_view* view, unsigned index,
+                        cc65_segmentdata* data);
+/* Fill in the data for an item in a view of segments */
+
+cc65_view cc65_get_segmentlist_view (cc65_dbginfo handle);
+/* Return a view of all segments */
+
+cc65_view cc65_segment_byid_view (cc65_dbginfo handle, unsigned id);
+/* Return a view of the segment with a specific id, see cc65_segment_byid */
+
+cc65_view cc65_get_segmentlist_byaddr_view (cc65_dbginfo handle);
+/* Return a view of all segments sorted by start address. Segments with the
+** same start address are sorted by id.
+*/
+
+cc65_view cc65_segment_byaddr_view (cc65_dbginfo handle, cc65_addr addr);
+/* Return a view of the segment that contains addr. The view is empty if no
+** segment contains it. If segments overlap, as banked segments may, the one
+** with the highest start address is returned.
+*/
+
 
 
 /*****************************************************************************/
@@ -628,6 +823,45 @@ const cc65_symbolinfo* cc65_symbol_inrange (cc65_dbginfo handle,
 void cc65_free_symbolinfo (cc65_dbginfo handle, const cc65_symbolinfo* info);
 /* Free a symbol info record */
 
+void cc65_symbol_data (const cc65_view* view, unsigned index,
+                       cc65_symboldata* data);
+/* Fill in the data for an item in a view of symbols */
+
+cc65_view cc65_get_symbollist_view (cc65_dbginfo handle);
+/* Return a view of all symbols */
+
+cc65_view cc65_symbol_byid_view (cc65_dbginfo handle, unsigned id);
+/* Return a view of the symbol with a given id, see cc65_symbol_byid */
+
+cc65_view cc65_symbol_byname_view (cc65_dbginfo handle, const char* name);
+/* Return a view of the symbols with a given name, see cc65_symbol_byname */
+
+cc65_view cc65_symbol_inrange_view (cc65_dbginfo handle,
+                                    cc65_addr start, cc65_addr end);
+/* Return a view of the labels in the given range, see cc65_symbol_inrange.
+** The labels are sorted by value.
+*/
+
+unsigned cc65_symbol_nearest (cc65_dbginfo handle, cc65_addr addr,
+                              cc65_addr* offset);
+/* Return the id of the label with the highest value at or below addr, which
+** is what's needed to show an address as label+offset. If offset isn't NULL,
+** addr minus the value of the label is stored there. If several labels have
+** this value, the first one by name is returned. Equates and imports are
+** never returned. The function returns CC65_INV_ID if there is no label at
+** or below addr.
+*/
+
+unsigned cc65_symbol_nearest_batch (cc65_dbginfo handle,
+                                    const cc65_addr* addrs, unsigned count,
+                                    unsigned* symbol_ids, cc65_addr* offsets);
+/* Look up the nearest labels for count addresses at once. For each address
+** in addrs, the result of cc65_symbol_nearest is stored at the same index in
+** symbol_ids, and the offset in offsets if that isn't NULL. The function
+** returns the number of addresses with a label. Many addresses are sorted
+** and merged with the labels instead of searching for each one.
+*/
+
 
 
 /*****************************************************************************/
@@ -27,75 +27,491 @@ SOFTWARE.
 
 
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#define HAVE_THREADS    1
+#else
+#define HAVE_THREADS    0
+#endif
 
 #include "dbginfo.h"
+#include "gpa.h"
 
 
 const unsigned int columnWidth = 40;
 
+/* Size of the output buffer. Rows are collected there and written in large blocks. */
+#define WRITER_BUFFER_SIZE  (1 << 20)
+
+/* Minimum number of rows worth a thread of their own, and the maximum number of threads per section */
+#ifndef CHUNK_ROWS
+#define CHUNK_ROWS          8192
+#endif
+#define MAX_CHUNKS          16
+
+/*****************************************************************************/
+/*                                   Memory                                  */
+/*****************************************************************************/
+
+
+
+/* Allocate memory, exiting with an error if there is none */
+static void* xmalloc(size_t size) {
+    void* p = malloc(size);
+    if(p == NULL && size > 0) {
+        printf("Out of memory.");
+        exit(1);
+    }
+    return p;
+}
+
+static void* xcalloc(size_t count, size_t size) {
+    void* p = calloc(count, size);
+    if(p == NULL && count > 0 && size > 0) {
+        printf("Out of memory.");
+        exit(1);
+    }
+    return p;
+}
+
+/* Resize a block of memory, exiting with an error if there is no memory. The old block isn't lost on failure, as the program ends. */
+static void* xrealloc(void* block, size_t size) {
+    void* p = realloc(block, size);
+    if(p == NULL && size > 0) {
+        printf("Out of memory.");
+        exit(1);
+    }
+    return p;
+}
+
+
+
+/*****************************************************************************/
+/*                                   Output                                  */
+/*****************************************************************************/
+
+
+
+int gpa_open_writer(gpa_writer* w, const char* name) {
+    /* Binary mode, so the \r\n row endings are written as they are */
+    w->file = fopen(name, "wb");
+    w->buf = NULL;
+    w->len = 0;
+    w->size = 0;
+    w->error = 0;
+    if(w->file == NULL) {
+        return -1;
+    }
+    /* Rows are collected in the writer's own buffer, so stdio doesn't need to buffer them again */
+    setvbuf(w->file, NULL, _IONBF, 0);
+    w->buf = xmalloc(WRITER_BUFFER_SIZE);
+    w->size = WRITER_BUFFER_SIZE;
+    return 0;
+}
+
+void gpa_open_buffer(gpa_writer* w) {
+    w->file = NULL;
+    w->buf = xmalloc(WRITER_BUFFER_SIZE);
+    w->len = 0;
+    w->size = WRITER_BUFFER_SIZE;
+    w->error = 0;
+}
+
+/* Write a block of bytes to the file */
+static void writeAll(gpa_writer* w, const char* s, size_t len) {
+    if(len > 0 && fwrite(s, 1, len, w->file) != len) {
+        w->error = 1;
+    }
+}
+
+static void flushWriter(gpa_writer* w) {
+    writeAll(w, w->buf, w->len);
+    w->len = 0;
+}
+
+/* Make room for len more bytes. A file is flushed, a memory buffer grows. Returns 0 if the bytes still don't fit. */
+static int makeRoom(gpa_writer* w, size_t len) {
+    if(w->file == NULL) {
+        while(w->size - w->len < len) {
+            w->size *= 2;
+        }
+        w->buf = xrealloc(w->buf, w->size);
+        return 1;
+    }
+    flushWriter(w);
+    return len <= w->size;
+}
+
+int gpa_close_writer(gpa_writer* w) {
+    flushWriter(w);
+    if(fclose(w->file) != 0) {
+        w->error = 1;
+    }
+    free(w->buf);
+    return w->error ? -1 : 0;
+}
+
+static void writeBytes(gpa_writer* w, const char* s, size_t len) {
+    if(w->size - w->len < len && !makeRoom(w, len)) {
+        /* Too large for the buffer, so it's written directly */
+        writeAll(w, s, len);
+        return;
+    }
+    memcpy(w->buf + w->len, s, len);
+    w->len += len;
+}
+
+/* Write a string and return its length, as fprintf returns the number of characters written */
+static int writeString(gpa_writer* w, const char* s) {
+    size_t len = strlen(s);
+    writeBytes(w, s, len);
+    return (int) len;
+}
+
+static void writeSpaces(gpa_writer* w, size_t count) {
+    while(count > 0) {
+        if(w->len == w->size) {
+            makeRoom(w, count);
+        }
+        size_t n = w->size - w->len < count ? w->size - w->len : count;
+        memset(w->buf + w->len, ' ', n);
+        w->len += n;
+        count -= n;
+    }
+}
+
+/* Write text left aligned in a field like %-*s. A negative width is treated as its absolute value, as printf does. */
+static void writePadded(gpa_writer* w, const char* s, size_t len, int width) {
+    writeBytes(w, s, len);
+    if(width < 0) {
+        width = -width;
+    }
+    if(len < (size_t) width) {
+        writeSpaces(w, width - len);
+    }
+}
+
+/* Write a value in upper case hex with at least the given number of digits, like %0*lX */
+static void writeHex(gpa_writer* w, unsigned long value, int digits) {
+    char text[2 * sizeof(unsigned long)];
+    char* p = text + sizeof(text);
+    do {
+        *--p = "0123456789ABCDEF"[value & 0xF];
+        value >>= 4;
+        digits--;
+    } while(value != 0 || digits > 0);
+    writeBytes(w, p, text + sizeof(text) - p);
+}
+
+/* Write a value in decimal, left aligned in a field like %-*d */
+static void writeDecimal(gpa_writer* w, int value, int width) {
+    char text[12];
+    char* p = text + sizeof(text);
+    unsigned magnitude = value < 0 ? 0U - (unsigned) value : (unsigned) value;
+    do {
+        *--p = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude != 0);
+    if(value < 0) {
+        *--p = '-';
+    }
+    writePadded(w, p, text + sizeof(text) - p, width);
+}
+
+void gpa_append_buffer(gpa_writer* w, gpa_writer* buffer) {
+    writeBytes(w, buffer->buf, buffer->len);
+    free(buffer->buf);
+}
+
+void gpa_print_header(gpa_writer* w, const char* name) {
+    writeString(w, "### GPA symbol file for ");
+    writeString(w, name);
+    writeString(w, " ###\r\n\r\n");
+}
+
+
+
+/*****************************************************************************/
+/*                                   Chunks                                  */
+/*****************************************************************************/
+
+
+
+/* A range of rows of a section. Large sections are split into chunks that are printed on separate threads. */
+typedef struct gpa_chunk gpa_chunk;
+struct gpa_chunk {
+    void          (*print)(gpa_chunk* chunk, gpa_writer* w);    /* Function that prints the rows */
+    const void*     context;        /* Data of the section shared by all chunks */
+    unsigned        first;          /* First row of the chunk */
+    unsigned        last;           /* Row after the last one of the chunk */
+    gpa_writer      buffer;         /* Output of the chunk when printed on its own thread */
+    const char*     firstFile;      /* Source lines: File of the first line, NULL if there is none */
+    const char*     lastFile;       /* Source lines: File of the last line, NULL if there is none */
+    size_t          headerLength;   /* Source lines: Length of the File: header before the first line */
+#if HAVE_THREADS
+    pthread_t       thread;         /* Thread printing the chunk */
+    int             started;        /* Set if the thread was started */
+#endif
+};
+
+/* Return the number of chunks to split a number of rows into */
+static unsigned chunkCount(unsigned rows) {
+#if HAVE_THREADS
+    unsigned long count = rows / CHUNK_ROWS;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpus > 0 && count > (unsigned long) cpus) {
+        count = cpus;
+    }
+    if(count > MAX_CHUNKS) {
+        count = MAX_CHUNKS;
+    }
+    return count > 1 ? count : 1;
+#else
+    (void) rows;
+    return 1;
+#endif
+}
+
+static void initChunks(gpa_chunk* chunks, unsigned count, void (*print)(gpa_chunk* chunk, gpa_writer* w), const void* context, unsigned rows) {
+    for(unsigned i = 0; i < count; i++) {
+        memset(&chunks[i], 0, sizeof(gpa_chunk));
+        chunks[i].print = print;
+        chunks[i].context = context;
+        chunks[i].first = (unsigned long) rows * i / count;
+        chunks[i].last = (unsigned long) rows * (i + 1) / count;
+    }
+}
+
+#if HAVE_THREADS
+static void* printChunk(void* arg) {
+    gpa_chunk* chunk = arg;
+    chunk->print(chunk, &chunk->buffer);
+    return NULL;
+}
+#endif
+
+/* Print several chunks into their buffers, all but the first on threads of their own. The caller writes out the buffers. */
+static void printChunks(gpa_chunk* chunks, unsigned count) {
+#if HAVE_THREADS
+    for(unsigned i = 0; i < count; i++) {
+        gpa_open_buffer(&chunks[i].buffer);
+        chunks[i].started = i > 0 && pthread_create(&chunks[i].thread, NULL, printChunk, &chunks[i]) == 0;
+    }
+    /* The first chunk, and any whose thread couldn't be started, are printed on this thread */
+    for(unsigned i = 0; i < count; i++) {
+        if(!chunks[i].started) {
+            printChunk(&chunks[i]);
+        }
+    }
+    for(unsigned i = 0; i < count; i++) {
+        if(chunks[i].started) {
+            pthread_join(chunks[i].thread, NULL);
+        }
+    }
+#else
+    (void) chunks;
+    (void) count;
+#endif
+}
+
+
+
+/*****************************************************************************/
+/*                                  Helpers                                  */
+/*****************************************************************************/
+
+
+
+/* Look up single items by id. The views borrow the data from Info, so nothing needs to be freed. */
+static cc65_symboldata symbolById(cc65_dbginfo Info, unsigned id) {
+    cc65_symboldata symbol;
+    cc65_view view = cc65_symbol_byid_view(Info, id);
+    cc65_symbol_data(&view, 0, &symbol);
+    return symbol;
+}
+
+static cc65_moduledata moduleById(cc65_dbginfo Info, unsigned id) {
+    cc65_moduledata module;
+    cc65_view view = cc65_module_byid_view(Info, id);
+    cc65_module_data(&view, 0, &module);
+    return module;
+}
+
+static cc65_sourcedata sourceById(cc65_dbginfo Info, unsigned id) {
+    cc65_sourcedata source;
+    cc65_view view = cc65_source_byid_view(Info, id);
+    cc65_source_data(&view, 0, &source);
+    return source;
+}
+
+
+
 /*****************************************************************************/
 /*                                   Labels                                  */
 /*****************************************************************************/
 
 
 
-void gpa_print_labels(FILE* f, cc65_dbginfo Info) {
-    const cc65_scopeinfo*    scopeList;
-    const cc65_symbolinfo*   symbolList;
+/* How a label is printed, worked out for all labels before any output */
+typedef struct gpa_labeldata gpa_labeldata;
+struct gpa_labeldata {
+    const char*     prefix;         /* Name printed before the label, or NULL */
+    int             scopeLabel;     /* The label is the symbol of a scope, so its size isn't printed */
+};
 
-    fprintf(f, "[USER]\r\n");
-    symbolList = cc65_symbol_inrange(Info, 0x0000, 0xFFFF);
-    for(int symbolIndex = 0; symbolIndex < symbolList->count; symbolIndex++) {
-        int column = columnWidth; /* Column counter for output alignment */
+/* Number of symbols sharing a name, for finding duplicates without a query per label */
+typedef struct gpa_namecount gpa_namecount;
+struct gpa_namecount {
+    const char*     name;           /* Pointer to the symbol name (within the CC65 data), NULL if unused */
+    unsigned        count;          /* Number of symbols with this name that aren't imports */
+};
 
-        /* Determine whether the symbol is a scope */
-        int scopeSymbol = 0;
-        scopeList = cc65_scope_byname(Info, symbolList->data[symbolIndex].symbol_name);
-        if(scopeList != 0) {
-            for(int scopeIndex = 0; scopeIndex < scopeList->count; scopeIndex++) {
-                if(scopeList->data[scopeIndex].symbol_id == symbolList->data[symbolIndex].symbol_id) {
-                    scopeSymbol = 1;
-                }
-            }
+/* Names are pooled by the debug info, so equal names have the same pointer and the pointer is hashed */
+static unsigned hashName(const char* name) {
+    unsigned hash = (unsigned) (uintptr_t) name * 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+/* Return the slot for a name in a hash table with a power of two size */
+static gpa_namecount* findName(gpa_namecount* table, unsigned size, const char* name) {
+    unsigned slot = hashName(name) & (size - 1);
+    while(table[slot].name && table[slot].name != name) {
+        slot = (slot + 1) & (size - 1);
+    }
+    return &table[slot];
+}
+
+/* Work out the prefix and scope flag of each label in a single pass over the scopes and symbols */
+static gpa_labeldata* decorateLabels(cc65_dbginfo Info, cc65_view labelList) {
+    cc65_view           symbolList = cc65_get_symbollist_view(Info);
+    cc65_view           scopeList = cc65_get_scopelist_view(Info);
+    cc65_symboldata     symbol;
+    cc65_scopedata      scope;
+
+    /* Count the symbols of each name that aren't imports */
+    unsigned tableSize = 1;
+    while(tableSize < symbolList.count * 2) {
+        tableSize *= 2;
+    }
+    gpa_namecount* names = xcalloc(tableSize, sizeof(gpa_namecount));
+    for(unsigned symbolIndex = 0; symbolIndex < symbolList.count; symbolIndex++) {
+        cc65_symbol_data(&symbolList, symbolIndex, &symbol);
+        gpa_namecount* name = findName(names, tableSize, symbol.symbol_name);
+        name->name = symbol.symbol_name;
+        if(symbol.symbol_type != CC65_SYM_IMPORT) {
+            name->count++;
         }
+    }
 
-        /* Prepend the label name for clarity where needed (cheap locals and duplicates */
-        const cc65_symbolinfo* symbolDuplicates = cc65_symbol_byname(Info, symbolList->data[symbolIndex].symbol_name);
-        if(symbolList->data[symbolIndex].parent_id != CC65_INV_ID) {
-            /* If the symbol is a cheap local */
-            column -= fprintf(f, "%s/", cc65_symbol_byid(Info, symbolList->data[symbolIndex].parent_id)->data[0].symbol_name);
-        } else if(symbolDuplicates->count > 1) {
-            /* If the symbol is a duplicate */
-            int isDuplicate = 0;
-            for(int i = 0; i < symbolDuplicates->count; i++) {
-                if(symbolDuplicates->data[i].symbol_id != symbolList->data[symbolIndex].symbol_id && symbolDuplicates->data[i].symbol_type != CC65_SYM_IMPORT) {
-                    isDuplicate = 1;
-                }
+    /* Mark the symbols of scopes, and get the prefix for duplicates in each scope */
+    unsigned char* scopeSymbols = xcalloc(symbolList.count + 1, 1);
+    const char** scopePrefixes = xcalloc(scopeList.count + 1, sizeof(const char*));
+    for(unsigned scopeIndex = 0; scopeIndex < scopeList.count; scopeIndex++) {
+        cc65_scope_data(&scopeList, scopeIndex, &scope);
+        if(scope.symbol_id < symbolList.count && symbolById(Info, scope.symbol_id).symbol_name == scope.scope_name) {
+            scopeSymbols[scope.symbol_id] = 1;
+        }
+        if(scope.scope_id < scopeList.count) {
+            if(*scope.scope_name != '\0') {
+                /* If the parent scope has a name, print it */
+                scopePrefixes[scope.scope_id] = scope.scope_name;
+            } else {
+                /* If the parent scope has no name, print the source file name of the span's parent module instead */
+                scopePrefixes[scope.scope_id] = sourceById(Info, moduleById(Info, scope.module_id).source_id).source_name;
             }
+        }
+    }
 
-            if(isDuplicate == 1) {
-                if(*cc65_scope_byid(Info, symbolList->data[symbolIndex].scope_id)->data[0].scope_name != '\0') {
-                    /* If the parent scope has a name, print it */
-                    column -= fprintf(f, "%s/", cc65_scope_byid(Info, symbolList->data[symbolIndex].scope_id)->data[0].scope_name);
-                } else {
-                    /* If the parent scope has no name, print the source file name of the span's parent module instead */
-                    column -= fprintf(f, "%s/", cc65_source_byid(Info, cc65_module_byid(Info, cc65_scope_byid(Info, symbolList->data[symbolIndex].scope_id)->data[0].module_id)->data[0].source_id)->data[0].source_name);
-                }
+    /* Decorate the labels */
+    gpa_labeldata* labels = xmalloc((labelList.count + 1) * sizeof(gpa_labeldata));
+    for(unsigned labelIndex = 0; labelIndex < labelList.count; labelIndex++) {
+        cc65_symbol_data(&labelList, labelIndex, &symbol);
+        labels[labelIndex].prefix = NULL;
+        labels[labelIndex].scopeLabel = symbol.symbol_id < symbolList.count && scopeSymbols[symbol.symbol_id];
+
+        /* Prepend the label name for clarity where needed (cheap locals and duplicates) */
+        if(symbol.parent_id != CC65_INV_ID) {
+            /* If the symbol is a cheap local */
+            labels[labelIndex].prefix = symbolById(Info, symbol.parent_id).symbol_name;
+        } else if(findName(names, tableSize, symbol.symbol_name)->count > (symbol.symbol_type != CC65_SYM_IMPORT)) {
+            /* If another symbol with this name isn't an import */
+            if(symbol.scope_id < scopeList.count) {
+                labels[labelIndex].prefix = scopePrefixes[symbol.scope_id];
             }
         }
+    }
+
+    free(scopePrefixes);
+    free(scopeSymbols);
+    free(names);
+    return labels;
+}
 
+
+
+/* The labels and their decoration, shared by all chunks */
+typedef struct gpa_labellist gpa_labellist;
+struct gpa_labellist {
+    cc65_view               symbolList;
+    const gpa_labeldata*    labels;
+};
+
+static void printLabelChunk(gpa_chunk* chunk, gpa_writer* w) {
+    const gpa_labellist*    list = chunk->context;
+    const gpa_labeldata*    labels = list->labels;
+    cc65_symboldata         symbol;
+
+    for(unsigned symbolIndex = chunk->first; symbolIndex < chunk->last; symbolIndex++) {
+        int column = columnWidth; /* Column counter for output alignment */
+        cc65_symbol_data(&list->symbolList, symbolIndex, &symbol);
+
+        if(labels[symbolIndex].prefix) {
+            column -= writeString(w, labels[symbolIndex].prefix);
+            column -= writeString(w, "/");
+        }
         /* Print the name and address */
-        fprintf(f, "%-*s %06lX", column, symbolList->data[symbolIndex].symbol_name, symbolList->data[symbolIndex].symbol_value);
+        writePadded(w, symbol.symbol_name, strlen(symbol.symbol_name), column);
+        writeString(w, " ");
+        writeHex(w, symbol.symbol_value, 6);
         /* Print the size if the symbol is not a scope */
-        if(scopeSymbol == 0 && symbolList->data[symbolIndex].symbol_size > 1) {
-            fprintf(f, " %X", symbolList->data[symbolIndex].symbol_size);
+        if(labels[symbolIndex].scopeLabel == 0 && symbol.symbol_size > 1) {
+            writeString(w, " ");
+            writeHex(w, symbol.symbol_size, 1);
+        }
+        writeString(w, "\r\n");
+    }
+}
+
+
+
+void gpa_print_labels(gpa_writer* w, cc65_dbginfo Info) {
+    gpa_labellist       list;
+    gpa_labeldata*      labels;
+    gpa_chunk           chunks[MAX_CHUNKS];
+    unsigned            count;
+
+    writeString(w, "[USER]\r\n");
+    list.symbolList = cc65_symbol_inrange_view(Info, 0x0000, 0xFFFF);
+    list.labels = labels = decorateLabels(Info, list.symbolList);
+
+    /* Print the labels in chunks, which are written out in order */
+    count = chunkCount(list.symbolList.count);
+    initChunks(chunks, count, printLabelChunk, &list, list.symbolList.count);
+    if(count == 1) {
+        printLabelChunk(&chunks[0], w);
+    } else {
+        printChunks(chunks, count);
+        for(unsigned i = 0; i < count; i++) {
+            gpa_append_buffer(w, &chunks[i].buffer);
         }
-        fprintf(f, "\r\n");
     }
-    fprintf(f, "\r\n");
+    free(labels);
+    writeString(w, "\r\n");
 }
 
 
@@ -106,26 +522,33 @@ void gpa_print_labels(FILE* f, cc65_dbginfo Info) {
 
 
 
-void gpa_print_scopes(FILE* f, cc65_dbginfo Info) {
-    const cc65_scopeinfo*    scopeList;
-    const cc65_symbolinfo*   symbolList;
+void gpa_print_scopes(gpa_writer* w, cc65_dbginfo Info) {
+    cc65_view           scopeList;
+    cc65_scopedata      scope;
 
-    scopeList = cc65_get_scopelist(Info);
-    fprintf(f, "[FUNCTIONS]\r\n");
-    scopeList = cc65_get_scopelist(Info);
+    writeString(w, "[FUNCTIONS]\r\n");
+    scopeList = cc65_get_scopelist_view(Info);
     unsigned scopeSize = 0;
-    for(int scopeIndex = 0; scopeIndex < scopeList->count; scopeIndex++) {
+    for(unsigned scopeIndex = 0; scopeIndex < scopeList.count; scopeIndex++) {
+        cc65_scope_data(&scopeList, scopeIndex, &scope);
         /* Scope names must be collected from the attached symbol */
-        symbolList = cc65_symbol_byid(Info, scopeList->data[scopeIndex].symbol_id);
+        cc65_view symbolList = cc65_symbol_byid_view(Info, scope.symbol_id);
         /* Only add a scope to the list if it's a procedure type with a valid range and name */
-        if(scopeList->data[scopeIndex].scope_type == CC65_SCOPE_SCOPE && scopeList->data[scopeIndex].scope_size > 0 && scopeList->data[scopeIndex].scope_name && symbolList) {
+        if(scope.scope_type == CC65_SCOPE_SCOPE && scope.scope_size > 0 && scope.scope_name && symbolList.count > 0) {
+            cc65_symboldata symbol;
+            cc65_symbol_data(&symbolList, 0, &symbol);
 
 //For plain .SCOPE definitions, there is no associated symbol. This is likely the cause of the segfault. Should check for symbols and not print if there is none.
-            scopeSize = (symbolList->data[0].symbol_value + scopeList->data[scopeIndex].scope_size - 1);
-            fprintf(f, "%-*s %06lX..%06X\r\n", columnWidth, scopeList->data[scopeIndex].scope_name, symbolList->data[0].symbol_value, scopeSize);
+            scopeSize = (symbol.symbol_value + scope.scope_size - 1);
+            writePadded(w, scope.scope_name, strlen(scope.scope_name), columnWidth);
+            writeString(w, " ");
+            writeHex(w, symbol.symbol_value, 6);
+            writeString(w, "..");
+            writeHex(w, scopeSize, 6);
+            writeString(w, "\r\n");
         }
     }
-    fprintf(f, "\r\n");
+    writeString(w, "\r\n");
 }
 
 
@@ -135,32 +558,26 @@ void gpa_print_scopes(FILE* f, cc65_dbginfo Info) {
 /*****************************************************************************/
 
 
-/* Compare segment addresses */
-static int compare_segmentdata(const void *a, const void *b) {
-    struct cc65_segmentdata *input_a = (cc65_segmentdata*)a;
-    struct cc65_segmentdata *input_b = (cc65_segmentdata*)b;
-    /* Sort by address */
-    if (input_a->segment_start > input_b->segment_start) return 1;
-    if (input_a->segment_start < input_b->segment_start) return -1;
-    return 0;
-}
-
-
-
-void gpa_print_segments(FILE* f, cc65_dbginfo Info) {
-    cc65_segmentinfo*  segmentList;
 
-    fprintf(f, "[SECTIONS]\r\n");
-    /* Get a list of all segments and sort them by address. Generates a compiler warning because the function returns a const type. */
-    segmentList = cc65_get_segmentlist(Info);
-    qsort(segmentList->data, segmentList->count, sizeof(cc65_segmentdata), compare_segmentdata);
+void gpa_print_segments(gpa_writer* w, cc65_dbginfo Info) {
+    cc65_view           segmentList;
+    cc65_segmentdata    segment;
 
-    for(int segmentIndex = 0; segmentIndex < segmentList->count; segmentIndex++) {
-        if(segmentList->data[segmentIndex].segment_size > 0 && strcmp(segmentList->data[segmentIndex].segment_name, "NULL") != 0) {
-            fprintf(f, "%-*s %06X..%06X\r\n", columnWidth, segmentList->data[segmentIndex].segment_name, segmentList->data[segmentIndex].segment_start, (segmentList->data[segmentIndex].segment_start + (segmentList->data[segmentIndex].segment_size - 1)));
+    writeString(w, "[SECTIONS]\r\n");
+    /* The library keeps the segments sorted by address */
+    segmentList = cc65_get_segmentlist_byaddr_view(Info);
+    for(unsigned segmentIndex = 0; segmentIndex < segmentList.count; segmentIndex++) {
+        cc65_segment_data(&segmentList, segmentIndex, &segment);
+        if(segment.segment_size > 0 && strcmp(segment.segment_name, "NULL") != 0) {
+            writePadded(w, segment.segment_name, strlen(segment.segment_name), columnWidth);
+            writeString(w, " ");
+            writeHex(w, segment.segment_start, 6);
+            writeString(w, "..");
+            writeHex(w, segment.segment_start + (segment.segment_size - 1), 6);
+            writeString(w, "\r\n");
         }
     }
-    fprintf(f, "\r\n");
+    writeString(w, "\r\n");
 }
 
 
@@ -174,7 +591,9 @@ void gpa_print_segments(FILE* f, cc65_dbginfo Info) {
 typedef struct gpa_sourcedata gpa_sourcedata;
 struct gpa_sourcedata {
     const char*     source_name;    /* Pointer to the source file's name (within the CC65 data) */
+    unsigned        source_id;      /* The id of the source code file */
     unsigned        source_line;    /* The line number in the source code file */
+    unsigned        line_id;        /* The id of the line */
     unsigned long   address_start;  /* The associated address */
     cc65_line_type  line_type;      /* Type of line (ASM, Macro, C) */
     unsigned        count;          /* Nesting counter for macros */
@@ -183,6 +602,7 @@ struct gpa_sourcedata {
 /* Compare source lines
 ** For each duplicate address, we want to prioritize more useful information.
 ** Assembly < C < Macro level 1 < Macro level 2, etc.
+** Lines with the same priority are kept in source file and line order.
 */
 static int compare_sourcedata(const void *a, const void *b) {
     struct gpa_sourcedata *input_a = (gpa_sourcedata*)a;
@@ -209,60 +629,141 @@ static int compare_sourcedata(const void *a, const void *b) {
     /* Sort by macro nesting depth */
     if (input_a->count > input_b->count) return 1;
     if (input_a->count < input_b->count) return -1;
+    /* Sort by source file, then by line */
+    if (input_a->source_id > input_b->source_id) return 1;
+    if (input_a->source_id < input_b->source_id) return -1;
+    if (input_a->source_line > input_b->source_line) return 1;
+    if (input_a->source_line < input_b->source_line) return -1;
+    if (input_a->line_id > input_b->line_id) return 1;
+    if (input_a->line_id < input_b->line_id) return -1;
     return 0;
 }
 
+/* The spans sorted by address, shared by all chunks */
+typedef struct gpa_spanlist gpa_spanlist;
+struct gpa_spanlist {
+    cc65_dbginfo    Info;
+    cc65_view       spanList;
+};
 
+/* Print the sorted lines at one address. All but the last one are superseded and commented. */
+static void printSourceGroup(gpa_writer* w, const gpa_sourcedata* group, unsigned groupCount, gpa_chunk* chunk) {
+    for(unsigned lineNumber = 0; lineNumber < groupCount; lineNumber++) {
+        /*Don't print the filename if the previous line was from the same file */
+        if(chunk->lastFile != group[lineNumber].source_name) {
+            size_t length = 0;
+            chunk->lastFile = group[lineNumber].source_name;
+            length += writeString(w, "\r\nFile: ");
+            length += writeString(w, chunk->lastFile);
+            length += writeString(w, "\r\n");
+            /* The first header of a chunk is dropped if the previous chunk ends in the same file */
+            if(chunk->firstFile == NULL) {
+                chunk->firstFile = chunk->lastFile;
+                chunk->headerLength = length;
+            }
+        }
+        int column = columnWidth;
+        if(lineNumber < groupCount - 1) {
+            column -= writeString(w, "#");
+        }
+        writeDecimal(w, group[lineNumber].source_line, column);
+        writeString(w, " ");
+        writeHex(w, group[lineNumber].address_start, 6);
+        writeString(w, "\r\n");
+    }
+}
 
-void gpa_print_sources(FILE* f, cc65_dbginfo Info) {
-    const cc65_lineinfo*     lineList;
-    const cc65_spaninfo*     spanList;
-    const cc65_sourceinfo*   sourceList;
+/* Print the lines of a range of spans. The range must not split the spans at one address. */
+static void printSourceChunk(gpa_chunk* chunk, gpa_writer* w) {
+    const gpa_spanlist* list = chunk->context;
+    cc65_dbginfo        Info = list->Info;
+    cc65_view           lineList;
+    cc65_linedata       line;
+    cc65_spandata       span;
+    gpa_sourcedata*     group = NULL;   /* Lines at the current address, sorted by priority */
+    unsigned            groupSize = 0;
+    unsigned            groupCount = 0;
+
+    /* Walk the spans in address order and collect the lines at each address */
+    for(unsigned spanIndex = chunk->first; spanIndex < chunk->last; spanIndex++) {
+        cc65_span_data(&list->spanList, spanIndex, &span);
+        /* Output the lines of the previous address once a span with a higher address follows */
+        if(groupCount > 0 && group[0].address_start != span.span_start) {
+            printSourceGroup(w, group, groupCount, chunk);
+            groupCount = 0;
+        }
+        lineList = cc65_line_byspan_view(Info, span.span_id);
+        for(unsigned lineIndex = 0; lineIndex < lineList.count; lineIndex++) {
+            cc65_line_data(&lineList, lineIndex, &line);
+            gpa_sourcedata source = {
+                .source_name =      sourceById(Info, line.source_id).source_name,
+                .source_id =        line.source_id,
+                .source_line =      line.source_line,
+                .line_id =          line.line_id,
+                .address_start =    span.span_start,
+                .line_type =        line.line_type,
+                .count =            line.count
+            };
+            if(groupCount == groupSize) {
+                groupSize = groupSize > 0 ? groupSize * 2 : 16;
+                group = xrealloc(group, groupSize * sizeof(gpa_sourcedata));
+            }
+            /* Insert the line by priority, with macros sources superseding C, C sources superseding assembly */
+            unsigned lineNumber = groupCount++;
+            while(lineNumber > 0 && compare_sourcedata(&group[lineNumber - 1], &source) > 0) {
+                group[lineNumber] = group[lineNumber - 1];
+                lineNumber--;
+            }
+            group[lineNumber] = source;
+        }
+    }
+    printSourceGroup(w, group, groupCount, chunk);
+    free(group);
+}
 
-    fprintf(f, "[SOURCE LINES]");
-    sourceList = cc65_get_sourcelist(Info);
-    int lineCount = 0;
-    int lineNumber = 0;
 
-    /* Declare the struct array using the total number of spans. Some lines don't have spans attached, so this won't be completely filled */
-    gpa_sourcedata gpaSources[cc65_get_spanlist(Info)->count];
 
-    /* Get the line data we need into a new array that can be sorted */
-    for(int sourceIndex = 0; sourceIndex < sourceList->count; sourceIndex++) {
-        lineList = cc65_line_bysource(Info, sourceIndex);
-        for(int lineIndex = 0; lineIndex < lineList->count; lineIndex++) {
-            spanList = cc65_span_byline(Info, lineList->data[lineIndex].line_id);
-            for(int spanIndex = 0; spanIndex < spanList->count; spanIndex++) {
-                gpaSources[lineNumber] = (gpa_sourcedata) {
-                    .source_name =      sourceList->data[sourceIndex].source_name,
-                    .source_line =      lineList->data[lineIndex].source_line,
-                    .address_start =    spanList->data[spanIndex].span_start,
-                    .line_type =        lineList->data[lineIndex].line_type,
-                    .count =            lineList->data[lineIndex].count
-                };
-                lineNumber++;
+void gpa_print_sources(gpa_writer* w, cc65_dbginfo Info) {
+    gpa_spanlist        list;
+    gpa_chunk           chunks[MAX_CHUNKS];
+    unsigned            count;
+    cc65_spandata       span;
+    cc65_spandata       previous;
+
+    writeString(w, "[SOURCE LINES]");
+    list.Info = Info;
+    list.spanList = cc65_get_spanlist_byaddr_view(Info);
+
+    /* Split the spans into chunks, moving the borders so the spans at one address stay together */
+    count = chunkCount(list.spanList.count);
+    initChunks(chunks, count, printSourceChunk, &list, list.spanList.count);
+    for(unsigned i = 1; i < count; i++) {
+        unsigned border = chunks[i].first > chunks[i - 1].first ? chunks[i].first : chunks[i - 1].first;
+        while(border > 0 && border < list.spanList.count) {
+            cc65_span_data(&list.spanList, border - 1, &previous);
+            cc65_span_data(&list.spanList, border, &span);
+            if(previous.span_start != span.span_start) {
+                break;
             }
+            border++;
         }
+        chunks[i - 1].last = chunks[i].first = border;
     }
-    lineCount = lineNumber;
-
-    /* Sort each line by address, with macros sources superseding C, C sources superseding assembly */
-    qsort(gpaSources, lineCount, sizeof(gpa_sourcedata), compare_sourcedata);
 
-    /* Output the source lines */
-    for(lineNumber = 0; lineNumber < lineCount; lineNumber++) {
-        /*Don't print the filename if the previous line was from the same file */
-        if(gpaSources[lineNumber - 1].source_name != gpaSources[lineNumber].source_name || lineNumber == 0) {
-            fprintf(f, "\r\nFile: %s\r\n", gpaSources[lineNumber].source_name);
-        }
-        /* Comment superseded lines, ignore the last line */
-        int column = columnWidth;
-        if(lineNumber < lineCount - 1) {
-            if(gpaSources[lineNumber].address_start == gpaSources[lineNumber + 1].address_start) {
-                column -= fprintf(f, "#");
+    if(count == 1) {
+        printSourceChunk(&chunks[0], w);
+    } else {
+        /* Write out the chunks in order. Each chunk starts with a File: header, which is skipped if the file didn't change. */
+        const char* fileName = NULL;
+        printChunks(chunks, count);
+        for(unsigned i = 0; i < count; i++) {
+            size_t skip = chunks[i].firstFile != NULL && chunks[i].firstFile == fileName ? chunks[i].headerLength : 0;
+            writeBytes(w, chunks[i].buffer.buf + skip, chunks[i].buffer.len - skip);
+            free(chunks[i].buffer.buf);
+            if(chunks[i].lastFile != NULL) {
+                fileName = chunks[i].lastFile;
             }
         }
-        fprintf(f, "%-*d %06lX\r\n", column, gpaSources[lineNumber].source_line, gpaSources[lineNumber].address_start);
     }
-    fprintf(f, "\r\n");
+    writeString(w, "\r\n");
 }
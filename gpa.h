@@ -27,10 +27,34 @@ SOFTWARE.
 
 
 
-void gpa_print_labels(FILE* f, cc65_dbginfo Info);
+/* Buffered output file for the GPA writers, or a memory buffer that collects the output */
+typedef struct gpa_writer gpa_writer;
+struct gpa_writer {
+    FILE*           file;           /* Output file, NULL for a memory buffer */
+    char*           buf;            /* Output buffer */
+    size_t          len;            /* Number of bytes in the buffer */
+    size_t          size;           /* Size of the buffer */
+    int             error;          /* Set if writing to the file failed */
+};
 
-void gpa_print_scopes(FILE* f, cc65_dbginfo Info);
+/* Create or truncate the output file. Returns 0 on success. */
+int gpa_open_writer(gpa_writer* w, const char* name);
 
-void gpa_print_segments(FILE* f, cc65_dbginfo Info);
+/* Write out the buffer and close the file. Returns 0 if all output was written. */
+int gpa_close_writer(gpa_writer* w);
 
-void gpa_print_sources(FILE* f, cc65_dbginfo Info);
+/* Create a writer that collects the output in memory. The buffer grows as needed. */
+void gpa_open_buffer(gpa_writer* w);
+
+/* Write the contents of a memory buffer to another writer, then free the buffer */
+void gpa_append_buffer(gpa_writer* w, gpa_writer* buffer);
+
+void gpa_print_header(gpa_writer* w, const char* name);
+
+void gpa_print_labels(gpa_writer* w, cc65_dbginfo Info);
+
+void gpa_print_scopes(gpa_writer* w, cc65_dbginfo Info);
+
+void gpa_print_segments(gpa_writer* w, cc65_dbginfo Info);
+
+void gpa_print_sources(gpa_writer* w, cc65_dbginfo Info);
@@ -30,6 +30,13 @@ SOFTWARE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#define HAVE_THREADS    1
+#else
+#define HAVE_THREADS    0
+#endif
 
 #include "dbginfo.h"
 #include "gpa.h"
@@ -60,7 +67,8 @@ struct argReturn {
 static void printHelp () {
     printf("gpa65 v1.0\n");
     printf("Usage: gpa65 [options] INPUT.dbg OUTPUT.sym\n");
-    printf("Convert cc65 debug data to GPA symbol files for logic analyzers.\n\n");
+    printf("Convert cc65 debug data to GPA symbol files for logic analyzers.\n");
+    printf("Use - as INPUT.dbg to read the debug data from standard input.\n\n");
     printf("Program options:\n");
     printf("  -w        Ignore source data warnings\n");
     printf("  -e        Ignore source data errors\n");
@@ -102,7 +110,7 @@ static argReturn findArgs(int argc, char* argv[]) {
     /* Check for arguments in filenames */
     r.inFile = argv[argc - 2];
     r.outFile = argv[argc - 1];
-    if(*r.inFile == '-' || *r.outFile == '-') {
+    if((*r.inFile == '-' && strcmp(r.inFile, "-") != 0) || *r.outFile == '-') {
         printf("Error: Missing filename.\n");
         printHelp();
         exit(1);
@@ -155,6 +163,9 @@ static argReturn findArgs(int argc, char* argv[]) {
 /* Debug file data */
 static cc65_dbginfo Info = 0;
 
+/* Name of the debug file when reading from standard input */
+#define STDIN_NAME "<stdin>"
+
 
 
 /* Error and warning counters */
@@ -186,6 +197,98 @@ static void FileError (const cc65_parseerror* Info)
 
 
 
+static cc65_dbgoptions loadOptions(const argReturn* opts)
+/* Load only the record kinds needed for the requested output */
+{
+    cc65_dbgoptions options = { .records = 0 };
+
+    if(opts->printSegments == 1) options.records |= CC65_RECORD_SEG;
+    if(opts->printScopes == 1) options.records |= CC65_RECORD_SCOPE | CC65_RECORD_SYM;
+    if(opts->printLabels == 1) options.records |= CC65_RECORD_SYM | CC65_RECORD_SCOPE | CC65_RECORD_MOD | CC65_RECORD_FILE;
+    if(opts->printLines == 1) options.records |= CC65_RECORD_LINE | CC65_RECORD_SPAN | CC65_RECORD_FILE;
+    return options;
+}
+
+
+
+static cc65_dbginfo readStdin(const cc65_dbgoptions* options)
+/* Parse debug info from standard input while it arrives */
+{
+    static char buf[65536];
+    size_t len;
+
+    cc65_dbgparser* parser = cc65_dbgparser_new(STDIN_NAME, options, FileError);
+    while((len = fread(buf, 1, sizeof(buf), stdin)) > 0) {
+        cc65_dbgparser_feed(parser, buf, len);
+    }
+    if(ferror(stdin)) {
+        printf("Error reading from standard input.\n");
+        exit(1);
+    }
+    return cc65_dbgparser_finish(parser);
+}
+
+
+
+/*****************************************************************************/
+/*                               Section output                              */
+/*****************************************************************************/
+
+
+
+typedef struct section section;
+struct section {
+    void          (*print)(gpa_writer* w, cc65_dbginfo Info);   /* Function that prints the section */
+    gpa_writer      buffer;         /* Output of the section when printed on its own thread */
+#if HAVE_THREADS
+    pthread_t       thread;         /* Thread printing the section */
+    int             started;        /* Set if the thread was started */
+#endif
+};
+
+
+
+static void* printSection(void* arg)
+/* Thread function: Print a section into its buffer */
+{
+    section* s = arg;
+    s->print(&s->buffer, Info);
+    return NULL;
+}
+
+
+
+static void printSections(gpa_writer* out, section* sections, unsigned count)
+/* Print the sections in the given order. With more than one CPU, every section
+** is printed into a buffer of its own on a separate thread, and the buffers are
+** written out in order, so the output is the same as when printing directly.
+*/
+{
+#if HAVE_THREADS
+    if(count > 1 && sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+        for(unsigned i = 0; i < count; i++) {
+            gpa_open_buffer(&sections[i].buffer);
+            sections[i].started = i > 0 && pthread_create(&sections[i].thread, NULL, printSection, &sections[i]) == 0;
+        }
+        /* The first section, and any whose thread couldn't be started, are printed on this thread */
+        for(unsigned i = 0; i < count; i++) {
+            if(sections[i].started) {
+                pthread_join(sections[i].thread, NULL);
+            } else {
+                printSection(&sections[i]);
+            }
+            gpa_append_buffer(out, &sections[i].buffer);
+        }
+        return;
+    }
+#endif
+    for(unsigned i = 0; i < count; i++) {
+        sections[i].print(out, Info);
+    }
+}
+
+
+
 /*****************************************************************************/
 /*                               Main Function                               */
 /*****************************************************************************/
@@ -195,8 +298,15 @@ static void FileError (const cc65_parseerror* Info)
 int main(int argc, char *argv[]) {
     argReturn opts = findArgs(argc, argv);
 
-    /* Open the debug info file */
-    Info = cc65_read_dbginfo(opts.inFile, FileError);
+    /* Open the debug info file, or read it from standard input */
+    const cc65_dbgoptions options = loadOptions(&opts);
+    const char* inName = opts.inFile;
+    if(strcmp(opts.inFile, "-") == 0) {
+        inName = STDIN_NAME;
+        Info = readStdin(&options);
+    } else {
+        Info = cc65_read_dbginfo_opt(opts.inFile, &options, FileError);
+    }
     if (FileErrors > 0) {
         printf("File loaded with %u errors\n", FileErrors);
         if(opts.ignoreErrors == 0) exit(1);
@@ -208,20 +318,26 @@ int main(int argc, char *argv[]) {
     }
 
     /* Open the output file */
-    FILE* f = fopen(opts.outFile,"w");
-    if(f == NULL) {
+    gpa_writer out;
+    if(gpa_open_writer(&out, opts.outFile) != 0) {
         printf("Error opening %s for write.", opts.outFile);
         exit(1);
     }
 
     /* Write the output file */
-    fprintf(f, "### GPA symbol file for %s ###\r\n\r\n", opts.inFile);
-    if(opts.printSegments == 1) gpa_print_segments(f, Info);
-    if(opts.printScopes == 1) gpa_print_scopes(f, Info);
-    if(opts.printLabels == 1) gpa_print_labels(f, Info);
-    if(opts.printLines == 1) gpa_print_sources(f, Info);
-
-    fclose(f);
+    section sections[4];
+    unsigned sectionCount = 0;
+    if(opts.printSegments == 1) sections[sectionCount++].print = gpa_print_segments;
+    if(opts.printScopes == 1) sections[sectionCount++].print = gpa_print_scopes;
+    if(opts.printLabels == 1) sections[sectionCount++].print = gpa_print_labels;
+    if(opts.printLines == 1) sections[sectionCount++].print = gpa_print_sources;
+    gpa_print_header(&out, inName);
+    printSections(&out, sections, sectionCount);
+
+    if(gpa_close_writer(&out) != 0) {
+        printf("Error writing %s.", opts.outFile);
+        exit(1);
+    }
     cc65_free_dbginfo(Info);
 
     return 0;